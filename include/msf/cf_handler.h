@@ -37,6 +37,12 @@ class ClipboardFormatHandler
         return m_canSetData;
     }
 
+    // Purpose: the storage medium types that are advertised by EnumFormatEtc.
+    [[nodiscard]] virtual DWORD GetTymed() const noexcept
+    {
+        return TYMED_HGLOBAL;
+    }
+
     [[nodiscard]] virtual HRESULT Validate(const FORMATETC& formatEtc) const noexcept
     {
         if (formatEtc.dwAspect != DVASPECT_CONTENT)
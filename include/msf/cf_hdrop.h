@@ -6,16 +6,24 @@
 #pragma once
 
 #include "smartptr/dataobjectptr.h"
+#include "drop_files.h"
+#include "global_lock.h"
 #include "stg_medium.h"
 #include "format_etc.h"
 
+#include <string>
+#include <string_view>
+#include <vector>
+
 namespace msf
 {
 
 /// <summary>Support class to handle the CF_HDROP format.</summary>
 /// <remarks>
 /// The CF_HDROP format is used by the shell to transfer a group of existing files.
-/// The handle refers to a set of DROPFILES structures.
+/// The handle refers to a DROPFILES structure. The file list is parsed once, when the format is retrieved,
+/// the file names are views in the locked memory of the format, which makes GetFile O(1) and
+/// removes the MAX_PATH limit of DragQueryFile.
 /// </remarks>
 class ClipboardFormatHDrop
 {
@@ -30,33 +38,71 @@ class ClipboardFormatHDrop
     explicit ClipboardFormatHDrop(IDataObjectPtr dataobject)
     {
         dataobject.GetData(FormatEtc(CF_HDROP), m_stgmedium);
+        ATLASSERT(m_stgmedium.tymed == TYMED_HGLOBAL && "Unable to retrieve file list");
+
+        m_globalLock.Attach(m_stgmedium.hGlobal);
+        const size_t size = GlobalSize(m_stgmedium.hGlobal);
+        if (IsWideDropFiles(m_globalLock.get(), size))
+        {
+            m_files = ParseDropFiles(m_globalLock.get(), size);
+        }
+        else
+        {
+            CopyAnsiFiles();
+        }
     }
 
+    ClipboardFormatHDrop(const ClipboardFormatHDrop&) = delete;
+    ClipboardFormatHDrop(ClipboardFormatHDrop&&) = delete;
+    ClipboardFormatHDrop& operator=(const ClipboardFormatHDrop&) = delete;
+    ClipboardFormatHDrop& operator=(ClipboardFormatHDrop&&) = delete;
+    ~ClipboardFormatHDrop() = default;
+
     [[nodiscard]] bool IsEmpty() const noexcept
     {
-        return GetFileCount() == 0;
+        return m_files.empty();
     }
 
     [[nodiscard]] uint32_t GetFileCount() const noexcept
     {
-        ATLASSERT(m_stgmedium.tymed == TYMED_HGLOBAL && "Unable to retrieve filecount");
-        return ::DragQueryFile(static_cast<HDROP>(m_stgmedium.hGlobal), static_cast<uint32_t>(-1), nullptr, 0);
+        return static_cast<uint32_t>(m_files.size());
     }
 
     [[nodiscard]] std::wstring GetFile(unsigned int index) const
     {
         ATLASSERT(index < GetFileCount() && "Index out of bounds");
+        return std::wstring(m_files[index]);
+    }
 
-        wchar_t szFileName[MAX_PATH];
-        if (!::DragQueryFile(static_cast<HDROP>(m_stgmedium.hGlobal), index, szFileName,
-                             _countof(szFileName)))
-            throw _com_error(HRESULT_FROM_WIN32(GetLastError()));
-
-        return szFileName;
+    // Purpose: the file names, valid as long as this instance is alive.
+    [[nodiscard]] const std::vector<std::wstring_view>& GetFiles() const noexcept
+    {
+        return m_files;
     }
 
 private:
+    // Purpose: fallback for the rare ANSI DROPFILES block, DragQueryFile converts the file names.
+    void CopyAnsiFiles()
+    {
+        const auto hdrop = static_cast<HDROP>(m_stgmedium.hGlobal);
+        const uint32_t fileCount = ::DragQueryFile(hdrop, static_cast<uint32_t>(-1), nullptr, 0);
+        m_ansiFiles.reserve(fileCount);
+        for (uint32_t i = 0; i < fileCount; ++i)
+        {
+            std::wstring fileName(::DragQueryFile(hdrop, i, nullptr, 0), L'\0');
+            if (!::DragQueryFile(hdrop, i, fileName.data(), static_cast<uint32_t>(fileName.size() + 1)))
+                throw _com_error(HRESULT_FROM_WIN32(GetLastError()));
+
+            m_ansiFiles.push_back(std::move(fileName));
+        }
+
+        m_files.assign(m_ansiFiles.begin(), m_ansiFiles.end());
+    }
+
     StorageMedium m_stgmedium;
+    util::GlobalLock<void> m_globalLock;
+    std::vector<std::wstring> m_ansiFiles;
+    std::vector<std::wstring_view> m_files;
 };
 
 } // namespace msf
@@ -5,88 +5,57 @@
 //
 #pragma once
 
-
-#include "cfhandler.h"
-#include "pidl.h"
+#include "cf_handler.h"
+#include "cida_builder.h"
+#include "stg_medium.h"
 #include "util.h"
-#include "stgmedium.h"
+
+#include <cstring>
+#include <vector>
 
 
 namespace msf
 {
 
-// Note: handler expect that pidls are alive as long as handler is used.
-
-class CCfShellIdListHandler : public ClipboardFormatHandler
+// Purpose: provides CFSTR_SHELLIDLIST. The CIDA is built once, when the handler is created:
+//          the handler doesn't depend on the lifetime of the passed PIDLs.
+class CCfShellIdListHandler final : public ClipboardFormatHandler
 {
 public:
-    CCfShellIdListHandler(LPCITEMIDLIST pidlFolder, std::vector<ItemIDList>& pidls)
-        :
+    CCfShellIdListHandler(PCIDLIST_ABSOLUTE pidlFolder, const PCUITEMID_CHILD* pidls, size_t count) :
         ClipboardFormatHandler(CFSTR_SHELLIDLIST, true, false),
-        m_pidlFolder(pidlFolder),
-        m_pidls(pidls)
+        m_cida{CreateCida(pidlFolder, pidls, count)}
     {
     }
 
+    ~CCfShellIdListHandler() = default;
+    CCfShellIdListHandler(const CCfShellIdListHandler&) = delete;
+    CCfShellIdListHandler(CCfShellIdListHandler&&) = delete;
     CCfShellIdListHandler& operator=(const CCfShellIdListHandler&) = delete;
-
-    [[nodiscard]] HRESULT Validate(const FORMATETC& formatetc) const override
-    {
-        if (formatetc.dwAspect != DVASPECT_CONTENT)
-            return DV_E_DVASPECT;
-
-        if (!IsBitSet(formatetc.tymed, TYMED_HGLOBAL))
-            return DV_E_TYMED;
-
-        if (formatetc.lindex != -1)
-            return DV_E_LINDEX;
-
-        return S_OK;
-    }
-
+    CCfShellIdListHandler& operator=(CCfShellIdListHandler&&) = delete;
 
     void GetData(const FORMATETC&, STGMEDIUM& stgmedium) const override
     {
-        const uint32_t sizeheader = static_cast<uint32_t>(sizeof(CIDA) + (sizeof(uint32_t) * m_pidls.size()));
-
-        uint32_t size = sizeheader + m_pidlFolder.GetSize();
-
-        for (auto it = m_pidls.begin(); it != m_pidls.end(); ++it)
-        {
-            size += it->GetSize();
-        }
-
-        StorageMedium medium(GlobalAllocThrow(size));
-
-        CIDA* pcida = static_cast<CIDA*>(medium.GetHGlobal());
-
-        pcida->cidl = static_cast<uint32_t>(m_pidls.size());
-
-        uint32_t offset = sizeheader;
-        offset += AddPidlToCida(pcida, m_pidlFolder, 0, offset);
-
-        for (uint32_t i = 0; i < m_pidls.size(); ++i)
-        {
-            offset += AddPidlToCida(pcida, m_pidls[i], i + 1, offset);
-        }
-
+        StorageMedium medium(GlobalAllocThrow(m_cida.size()));
+        std::memcpy(medium.GetHGlobal(), m_cida.data(), m_cida.size());
         medium.Detach(stgmedium);
     }
 
 private:
-
-    unsigned int AddPidlToCida(CIDA* pcida, const ItemIDList& pidl, uint32_t index, uint32_t offset) const noexcept
+    [[nodiscard]] static std::vector<std::byte> CreateCida(PCIDLIST_ABSOLUTE pidlFolder, const PCUITEMID_CHILD* pidls, size_t count)
     {
-        pcida->aoffset[index] = offset;
+        CidaBuilder cidaBuilder(pidlFolder, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            cidaBuilder.Add(pidls[i]);
+        }
 
-        const unsigned int size = pidl.GetSize();
-        memcpy(reinterpret_cast<BYTE*>(pcida) + offset, pidl.get(), size);
-        return size;
+        std::vector<std::byte> cida(cidaBuilder.GetSize());
+        cidaBuilder.Write(cida.data());
+        return cida;
     }
 
-    ItemIDList m_pidlFolder;
-    std::vector<ItemIDList>& m_pidls;
+    std::vector<std::byte> m_cida;
 };
 
 } // end of msf namespace
-
@@ -0,0 +1,214 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+#include "msf_base.h"
+#include "pidl.h"
+#include "pidl_intern_table.h"
+
+#include <cstddef>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace msf
+{
+
+// Purpose: sends the change notifications of a ChangeNotifyBatcher to the shell.
+//          The items are relative to the folder, a null item1 reports the folder itself.
+struct ShellChangeNotifySink final
+{
+    void Notify(long eventId, uint32_t flags, PCIDLIST_ABSOLUTE folder, PCUIDLIST_RELATIVE item1, PCUIDLIST_RELATIVE item2) const
+    {
+        if (!item1)
+        {
+            SHChangeNotify(eventId, flags | SHCNF_IDLIST, folder, nullptr);
+            return;
+        }
+
+        const TransientItemIDList absoluteItem1(folder, item1);
+        if (item2)
+        {
+            const TransientItemIDList absoluteItem2(folder, item2);
+            SHChangeNotify(eventId, flags | SHCNF_IDLIST, absoluteItem1.GetAbsolute(), absoluteItem2.GetAbsolute());
+        }
+        else
+        {
+            SHChangeNotify(eventId, flags | SHCNF_IDLIST, absoluteItem1.GetAbsolute(), nullptr);
+        }
+    }
+};
+
+/// <summary>Collects the change notifications of the items of 1 folder during an operation and sends them at the end.</summary>
+/// <remarks>
+/// Equal events (same event id and items) are sent once. When the number of events passes the collapse threshold,
+/// the events are replaced by 1 SHCNE_UPDATEDIR of the folder, additional events are then ignored (no memory is used).
+/// Flush posts the events without waiting for the listeners: the last event is sent with SHCNF_FLUSHNOWAIT
+/// (callers that must wait can pass SHCNF_FLUSH).
+/// The folder PIDL is borrowed, the item PIDLs are interned in the process wide PidlInternTable: an event is stored
+/// and compared as 2 handles. Batchers are short lived, sharing the table avoids that every batcher creates its own.
+/// TSink receives the events, which makes the policy testable.
+/// </remarks>
+template <typename TSink = ShellChangeNotifySink>
+class ChangeNotifyBatcher final
+{
+public:
+    static constexpr size_t DefaultCollapseThreshold = 64;
+
+    explicit ChangeNotifyBatcher(PCIDLIST_ABSOLUTE folder, size_t collapseThreshold = DefaultCollapseThreshold, TSink sink = TSink()) :
+        m_folder{folder},
+        m_collapseThreshold{collapseThreshold},
+        m_sink{std::move(sink)},
+        m_pidls{PidlInternTable::GetProcessTable()}
+    {
+    }
+
+    ~ChangeNotifyBatcher()
+    {
+        Reset();
+    }
+
+    ChangeNotifyBatcher(const ChangeNotifyBatcher&) = delete;
+    ChangeNotifyBatcher(ChangeNotifyBatcher&&) = delete;
+    ChangeNotifyBatcher& operator=(const ChangeNotifyBatcher&) = delete;
+    ChangeNotifyBatcher& operator=(ChangeNotifyBatcher&&) = delete;
+
+    void Add(long eventId, PCUIDLIST_RELATIVE item1, PCUIDLIST_RELATIVE item2 = nullptr)
+    {
+        if (m_collapsed)
+            return;
+
+        Event event{eventId, Intern(item1), PidlInternTable::InvalidHandle};
+        try
+        {
+            event.item2 = Intern(item2);
+            if (m_eventSet.find(event) != m_eventSet.end())
+            {
+                Release(event);
+                return;
+            }
+
+            if (m_events.size() == m_collapseThreshold)
+            {
+                Release(event);
+                Collapse();
+                return;
+            }
+
+            m_events.reserve(m_events.size() + 1);
+            m_eventSet.insert(event);
+        }
+        catch (...)
+        {
+            Release(event);
+            throw;
+        }
+
+        m_events.push_back(event);
+    }
+
+    [[nodiscard]] bool IsCollapsed() const noexcept
+    {
+        return m_collapsed;
+    }
+
+    // Purpose: the number of events that Flush will send.
+    [[nodiscard]] size_t GetEventCount() const noexcept
+    {
+        return m_collapsed ? 1 : m_events.size();
+    }
+
+    // Purpose: sends the collected events and resets the batcher, the last event is sent with 'flushFlags'.
+    void Flush(uint32_t flushFlags = SHCNF_FLUSHNOWAIT)
+    {
+        if (m_collapsed)
+        {
+            m_sink.Notify(SHCNE_UPDATEDIR, flushFlags, m_folder, nullptr, nullptr);
+        }
+        else
+        {
+            for (size_t i = 0; i < m_events.size(); ++i)
+            {
+                const auto& event = m_events[i];
+                m_sink.Notify(event.eventId, i + 1 == m_events.size() ? flushFlags : 0, m_folder,
+                              GetPidl(event.item1), GetPidl(event.item2));
+            }
+        }
+
+        Reset();
+    }
+
+private:
+    struct Event
+    {
+        long eventId;
+        PidlInternTable::Handle item1;
+        PidlInternTable::Handle item2;
+
+        [[nodiscard]] bool operator==(const Event& other) const noexcept
+        {
+            return eventId == other.eventId && item1 == other.item1 && item2 == other.item2;
+        }
+    };
+
+    struct EventHash
+    {
+        [[nodiscard]] size_t operator()(const Event& event) const noexcept
+        {
+            return static_cast<size_t>(((static_cast<uint64_t>(static_cast<uint32_t>(event.eventId)) << 32) | event.item1) ^
+                                       (uint64_t{event.item2} * 0x9E3779B97F4A7C15));
+        }
+    };
+
+    [[nodiscard]] PidlInternTable::Handle Intern(PCUIDLIST_RELATIVE pidl)
+    {
+        return pidl ? m_pidls.Intern(pidl) : PidlInternTable::InvalidHandle;
+    }
+
+    void Release(const Event& event) noexcept
+    {
+        for (const auto handle : {event.item1, event.item2})
+        {
+            if (handle != PidlInternTable::InvalidHandle)
+            {
+                m_pidls.Release(handle);
+            }
+        }
+    }
+
+    [[nodiscard]] PCUIDLIST_RELATIVE GetPidl(PidlInternTable::Handle handle) const noexcept
+    {
+        return handle == PidlInternTable::InvalidHandle ? nullptr : static_cast<PCUIDLIST_RELATIVE>(m_pidls.GetPidl(handle));
+    }
+
+    void Collapse() noexcept
+    {
+        Reset();
+        m_collapsed = true;
+    }
+
+    void Reset() noexcept
+    {
+        for (const auto& event : m_events)
+        {
+            Release(event);
+        }
+
+        m_events.clear();
+        m_eventSet.clear();
+        m_collapsed = false;
+    }
+
+    PCIDLIST_ABSOLUTE m_folder;
+    size_t m_collapseThreshold;
+    TSink m_sink;
+    PidlInternTable& m_pidls;
+    std::vector<Event> m_events;
+    std::unordered_set<Event, EventHash> m_eventSet;
+    bool m_collapsed{};
+};
+
+} // namespace msf
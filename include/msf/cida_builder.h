@@ -0,0 +1,104 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library),
+//       the layout of a CIDA is: uint32_t cidl, uint32_t aoffset[cidl + 1], followed by the PIDLs.
+
+#include "pidl_hash.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace msf
+{
+
+/// <summary>Builds the CIDA (CFSTR_SHELLIDLIST) of a folder and a set of items.</summary>
+/// <remarks>
+/// The PIDLs are borrowed and must stay alive as long as the builder is used. The size of every PIDL
+/// is computed once, when it is added. Write fills a buffer of GetSize() bytes in 1 pass: the header
+/// followed by the PIDLs, every PIDL starts at a 4 byte aligned offset.
+/// </remarks>
+class CidaBuilder final
+{
+public:
+    explicit CidaBuilder(const void* folderPidl, size_t itemCountHint = 0)
+    {
+        m_pidls.reserve(itemCountHint + 1);
+        Add(folderPidl);
+    }
+
+    void Add(const void* pidl)
+    {
+        const size_t size = GetPidlSize(pidl);
+        if (m_payloadSize + AlignSize(size) > MaxPayloadSize)
+            throw std::length_error("CIDA too large");
+
+        m_pidls.push_back({pidl, static_cast<uint32_t>(size)});
+        m_payloadSize += AlignSize(size);
+    }
+
+    // Purpose: the number of items, the folder is not included.
+    [[nodiscard]] size_t GetItemCount() const noexcept
+    {
+        return m_pidls.size() - 1;
+    }
+
+    // Purpose: the number of bytes that Write will fill.
+    [[nodiscard]] size_t GetSize() const noexcept
+    {
+        return GetHeaderSize() + m_payloadSize;
+    }
+
+    void Write(void* buffer) const noexcept
+    {
+        auto* bytes = static_cast<std::byte*>(buffer);
+
+        const auto count = static_cast<uint32_t>(GetItemCount());
+        std::memcpy(bytes, &count, sizeof count);
+
+        auto offset = static_cast<uint32_t>(GetHeaderSize());
+        for (size_t i = 0; i < m_pidls.size(); ++i)
+        {
+            const auto& pidl = m_pidls[i];
+            std::memcpy(bytes + sizeof(uint32_t) + (i * sizeof(uint32_t)), &offset, sizeof offset);
+            std::memcpy(bytes + offset, pidl.data, pidl.size);
+
+            const size_t alignedSize = AlignSize(pidl.size);
+            std::memset(bytes + offset + pidl.size, 0, alignedSize - pidl.size);
+            offset += static_cast<uint32_t>(alignedSize);
+        }
+    }
+
+private:
+    struct Pidl
+    {
+        const void* data;
+        uint32_t size;
+    };
+
+    static constexpr size_t Alignment = sizeof(uint32_t);
+    static constexpr size_t MaxPayloadSize = UINT32_MAX / 2;
+
+    [[nodiscard]] static size_t AlignSize(size_t size) noexcept
+    {
+        return (size + Alignment - 1) & ~(Alignment - 1);
+    }
+
+    // Note: the header size is a multiple of 4, which makes the first PIDL aligned.
+    [[nodiscard]] size_t GetHeaderSize() const noexcept
+    {
+        return sizeof(uint32_t) + (m_pidls.size() * sizeof(uint32_t));
+    }
+
+    std::vector<Pidl> m_pidls;
+    size_t m_payloadSize{};
+};
+
+} // namespace msf
@@ -6,10 +6,12 @@
 #pragma once
 
 
-#include "msfbase.h"
-#include "cfhandler.h"
-#include "enumformatetc.h"
-#include "stgmedium.h"
+#include "msf_base.h"
+#include "cf_handler.h"
+#include "clipboard_format_handler_map.h"
+#include "enum_format_etc.h"
+#include "format_etc.h"
+#include "stg_medium.h"
 
 #include <atlctl.h> // for IDataObjectImpl
 
@@ -23,7 +25,6 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
 {
     class CExternalData;
 
-    using CfHandlerVector = std::vector<std::unique_ptr<ClipboardFormatHandler>>;
     using ExternalDataVector = std::vector<std::unique_ptr<CExternalData>>;
 
 public:
@@ -34,11 +35,10 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
 
     void RegisterCfHandler(std::unique_ptr<ClipboardFormatHandler> clipFormatHandler)
     {
-        ATLASSERT(!FindClipFormatHandler(clipFormatHandler->GetClipFormat()) && "Cannot register a ClipBoard handler twice!");
-        m_cfhandlers.push_back(clipFormatHandler);
+        m_cfhandlers.Register(std::move(clipFormatHandler));
     }
 
-    HRESULT __stdcall EnumFormatEtc(DWORD direction, IEnumFORMATETC** /*enumFormatEtc*/) noexcept override
+    HRESULT __stdcall EnumFormatEtc(DWORD direction, IEnumFORMATETC** enumFormatEtc) noexcept override
     {
         ATLTRACE(L"ClipboardDataObjectImpl::EnumFormatEtc (direction=%d)\n", direction);
 
@@ -51,8 +51,7 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
             GetRegisteredFormats(formatEtcs, direction);
             GetExternalFormats(formatEtcs);
 
-            uint16_t
-            SHCreateStdEnumFmtEtc(static_cast<uint32_t>(formatEtcs.size()), formatEtcs.data());
+            *enumFormatEtc = SHCreateStdEnumFmtEtc(static_cast<uint32_t>(formatEtcs.size()), formatEtcs.data()).Detach();
             return S_OK;
         }
         catch (...)
@@ -68,7 +67,7 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
 
         try
         {
-            const ClipboardFormatHandler* pcfhandler = FindClipFormatHandler(formatEtc->cfFormat);
+            const ClipboardFormatHandler* pcfhandler = m_cfhandlers.Find(formatEtc->cfFormat);
             if (pcfhandler)
             {
                 if (pcfhandler->CanGetData())
@@ -101,7 +100,7 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
 
         try
         {
-            ClipboardFormatHandler* pcfhandler = FindClipFormatHandler(formatEtc->cfFormat);
+            ClipboardFormatHandler* pcfhandler = m_cfhandlers.Find(formatEtc->cfFormat);
             if (pcfhandler)
             {
                 if (pcfhandler->CanGetData())
@@ -143,13 +142,13 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
             if (formatEtc->tymed != storageMedium->tymed)
                 return DV_E_TYMED;
 
-            ClipboardFormatHandler* pcfhandler = FindClipFormatHandler(formatEtc->cfFormat);
+            ClipboardFormatHandler* pcfhandler = m_cfhandlers.Find(formatEtc->cfFormat);
             if (pcfhandler)
             {
                 if (pcfhandler->CanSetData())
                 {
                     RaiseExceptionIfFailed(pcfhandler->Validate(*formatEtc));
-                    pcfhandler->SetData(*formatEtc, *storageMedium, release);
+                    pcfhandler->SetData(*formatEtc, *storageMedium, release != FALSE);
                     return S_OK;
                 }
 
@@ -228,37 +227,31 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
         void Update(const FORMATETC& formatetc, STGMEDIUM& stgmedium)
         {
             m_formatetc = formatetc;
+            if (m_stgmedium.tymed != TYMED_NULL)
+            {
+                ReleaseStgMedium(&m_stgmedium);
+            }
+
             m_stgmedium = stgmedium;
         }
 
-        void Copy(STGMEDIUM& stgmedium) const
+        // Purpose: the receiver shares the memory of the external data, it is not copied for every GetData.
+        void Copy(STGMEDIUM& stgmedium)
         {
-            m_stgmedium.CopyTo(stgmedium);
+            m_stgmedium.ShareTo(stgmedium);
         }
 
     private:
-        CFormatEtc m_formatetc;
+        FormatEtc m_formatetc;
         StorageMedium m_stgmedium;
     };
 
-    [[nodiscard]] ClipboardFormatHandler* FindClipFormatHandler(CLIPFORMAT clipformat) const noexcept
-    {
-        auto handler = std::find_if(m_cfhandlers.begin(), m_cfhandlers.end(),
-            [=](ClipboardFormatHandler* cfHandler)
-        {
-            return cfHandler->GetClipFormat() == clipformat;
-        });
-        return handler == m_cfhandlers.end() ? nullptr : handler;
-    }
-
     CExternalData* FindExternalData(CLIPFORMAT clipformat) const noexcept
     {
-        for (typename CExternalDatas::const_iterator it = m_externaldatas.begin(); it != m_externaldatas.end(); ++it)
+        for (const auto& externalData : m_externaldatas)
         {
-            if ((*it)->GetClipFormat() == clipformat)
-            {
-                return *it;
-            }
+            if (externalData->GetClipFormat() == clipformat)
+                return externalData.get();
         }
 
         return nullptr;
@@ -272,35 +265,26 @@ class ClipboardDataObjectImpl : public ATL::IDataObjectImpl<T>
 
     void GetRegisteredFormats(std::vector<FORMATETC>& formatetcs, DWORD direction) const
     {
-        for (auto it = m_cfhandlers.begin(); it != m_cfhandlers.end(); ++it)
+        for (const auto& handler : m_cfhandlers)
         {
-            if (direction == DATADIR_GET)
-            {
-                if ((*it)->CanGetData())
-                {
-                    formatetcs.push_back(CFormatEtc((*it)->GetClipFormat()));
-                }
-            }
-            else
+            if (direction == DATADIR_GET ? handler->CanGetData() : handler->CanSetData())
             {
-                if ((*it)->CanSetData())
-                {
-                    formatetcs.push_back(CFormatEtc((*it)->GetClipFormat()));
-                }
+                formatetcs.push_back(FormatEtc(handler->GetClipFormat(), handler->GetTymed()));
             }
         }
     }
 
+    // Note: the target devices of external formats are never set (SetData rejects them), the FORMATETCs can be copied bitwise.
     void GetExternalFormats(std::vector<FORMATETC>& formatetcs) const
     {
-        for (auto externalData : m_externaldatas)
+        for (const auto& externalData : m_externaldatas)
         {
             formatetcs.push_back(externalData->GetFormatetc());
         }
     }
 
-    CfHandlerVector m_cfhandlers;
-    CExternalDatas m_externaldatas;
+    ClipboardFormatHandlerMap m_cfhandlers;
+    ExternalDataVector m_externaldatas;
 };
 
 }
@@ -0,0 +1,74 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+#include "cf_handler.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace msf
+{
+
+/// <summary>Owns the clipboard format handlers of a data object and finds them by clipboard format.</summary>
+/// <remarks>
+/// The lookup is a binary search in a flat array of clipboard formats, sorted on registration.
+/// A data object has a handful of handlers, this makes a lookup a few compares in 1 or 2 cache lines.
+/// Iteration returns the handlers in registration order, which is the preferred order for EnumFormatEtc.
+/// </remarks>
+class ClipboardFormatHandlerMap final
+{
+public:
+    using Handlers = std::vector<std::unique_ptr<ClipboardFormatHandler>>;
+
+    ClipboardFormatHandlerMap() = default;
+    ~ClipboardFormatHandlerMap() = default;
+    ClipboardFormatHandlerMap(const ClipboardFormatHandlerMap&) = delete;
+    ClipboardFormatHandlerMap(ClipboardFormatHandlerMap&&) = delete;
+    ClipboardFormatHandlerMap& operator=(const ClipboardFormatHandlerMap&) = delete;
+    ClipboardFormatHandlerMap& operator=(ClipboardFormatHandlerMap&&) = delete;
+
+    void Register(std::unique_ptr<ClipboardFormatHandler> handler)
+    {
+        const CLIPFORMAT clipFormat = handler->GetClipFormat();
+        const auto position = std::lower_bound(m_clipFormats.begin(), m_clipFormats.end(), clipFormat);
+        ATLASSERT((position == m_clipFormats.end() || *position != clipFormat) && "Cannot register a ClipBoard handler twice!");
+
+        m_handlers.reserve(m_handlers.size() + 1);
+        m_index.reserve(m_index.size() + 1);
+        const auto offset = position - m_clipFormats.begin();
+        m_clipFormats.insert(position, clipFormat);
+        m_index.insert(m_index.begin() + offset, handler.get());
+        m_handlers.push_back(std::move(handler));
+    }
+
+    [[nodiscard]] ClipboardFormatHandler* Find(CLIPFORMAT clipFormat) const noexcept
+    {
+        const auto position = std::lower_bound(m_clipFormats.begin(), m_clipFormats.end(), clipFormat);
+        if (position == m_clipFormats.end() || *position != clipFormat)
+            return nullptr;
+
+        return m_index[static_cast<size_t>(position - m_clipFormats.begin())];
+    }
+
+    [[nodiscard]] Handlers::const_iterator begin() const noexcept
+    {
+        return m_handlers.begin();
+    }
+
+    [[nodiscard]] Handlers::const_iterator end() const noexcept
+    {
+        return m_handlers.end();
+    }
+
+private:
+    std::vector<CLIPFORMAT> m_clipFormats;        // sorted.
+    std::vector<ClipboardFormatHandler*> m_index; // same order as m_clipFormats.
+    Handlers m_handlers;                          // registration order.
+};
+
+} // namespace msf
@@ -0,0 +1,154 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library),
+//       the layout of a DROPFILES block is: the DropFilesHeader, followed at offset 'files' by a list of
+//       null terminated file names, the list is terminated by an empty file name.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace msf
+{
+
+// Purpose: same layout as DROPFILES (shlobj.h): offset of the file list, drop point, non-client flag and wide flag.
+struct DropFilesHeader
+{
+    uint32_t files;
+    int32_t x;
+    int32_t y;
+    int32_t nonClient;
+    int32_t wide;
+};
+
+static_assert(sizeof(DropFilesHeader) == 20, "DropFilesHeader must match the layout of DROPFILES");
+
+// Purpose: returns true when the file names of the DROPFILES block are stored as UTF-16 (the common case).
+[[nodiscard]] inline bool IsWideDropFiles(const void* data, size_t size)
+{
+    if (size < sizeof(DropFilesHeader))
+        throw std::invalid_argument("DROPFILES block too small");
+
+    DropFilesHeader header;
+    std::memcpy(&header, data, sizeof header);
+    return header.wide != 0;
+}
+
+/// <summary>Parses the file names of a wide DROPFILES block in 1 pass.</summary>
+/// <remarks>
+/// The returned views refer to the passed block, it must stay alive (locked) as long as the views are used.
+/// The length of a file name is not limited (long paths are supported). The end of the block is accepted as the
+/// end of the list, a file name that is not null terminated is rejected.
+/// </remarks>
+template <typename TChar = wchar_t>
+[[nodiscard]] std::vector<std::basic_string_view<TChar>> ParseDropFiles(const void* data, size_t size)
+{
+    static_assert(sizeof(TChar) == sizeof(uint16_t), "DROPFILES file names are UTF-16");
+
+    if (!IsWideDropFiles(data, size))
+        throw std::invalid_argument("DROPFILES block is not wide");
+
+    DropFilesHeader header;
+    std::memcpy(&header, data, sizeof header);
+    if (header.files < sizeof(DropFilesHeader) || header.files > size || header.files % alignof(TChar) != 0 ||
+        reinterpret_cast<uintptr_t>(data) % alignof(TChar) != 0)
+        throw std::invalid_argument("DROPFILES file list offset is invalid");
+
+    const auto* position = reinterpret_cast<const TChar*>(static_cast<const std::byte*>(data) + header.files);
+    const TChar* end = position + ((size - header.files) / sizeof(TChar));
+
+    std::vector<std::basic_string_view<TChar>> files;
+    while (position != end)
+    {
+        const TChar* terminator = std::char_traits<TChar>::find(position, static_cast<size_t>(end - position), TChar{});
+        if (!terminator)
+            throw std::invalid_argument("DROPFILES file name is not terminated");
+
+        if (terminator == position)
+            break; // empty file name: end of the list.
+
+        files.emplace_back(position, static_cast<size_t>(terminator - position));
+        position = terminator + 1;
+    }
+
+    return files;
+}
+
+/// <summary>Builds a wide DROPFILES block (CF_HDROP) from a list of file names.</summary>
+/// <remarks>
+/// The file names are borrowed and must stay alive as long as the builder is used. The size of the
+/// block is accumulated when a file name is added, Write fills a buffer of GetSize() bytes in 1 pass.
+/// </remarks>
+template <typename TChar = wchar_t>
+class DropFilesBuilder final
+{
+public:
+    using StringView = std::basic_string_view<TChar>;
+
+    static_assert(sizeof(TChar) == sizeof(uint16_t), "DROPFILES file names are UTF-16");
+
+    explicit DropFilesBuilder(size_t fileCountHint = 0)
+    {
+        m_files.reserve(fileCountHint);
+    }
+
+    void Add(StringView file)
+    {
+        // Note: an empty file name would terminate the list.
+        if (file.empty() || file.find(TChar{}) != StringView::npos)
+            throw std::invalid_argument("invalid file name");
+
+        if (file.size() + 1 > MaxCharCount - m_charCount)
+            throw std::length_error("DROPFILES block too large");
+
+        m_files.push_back(file);
+        m_charCount += file.size() + 1;
+    }
+
+    [[nodiscard]] size_t GetFileCount() const noexcept
+    {
+        return m_files.size();
+    }
+
+    // Purpose: the number of bytes that Write will fill.
+    [[nodiscard]] size_t GetSize() const noexcept
+    {
+        return sizeof(DropFilesHeader) + ((m_charCount + 1) * sizeof(TChar));
+    }
+
+    void Write(void* buffer) const noexcept
+    {
+        auto* bytes = static_cast<std::byte*>(buffer);
+
+        const DropFilesHeader header{sizeof(DropFilesHeader), 0, 0, 0, 1};
+        std::memcpy(bytes, &header, sizeof header);
+        bytes += sizeof header;
+
+        for (const auto file : m_files)
+        {
+            const size_t size = file.size() * sizeof(TChar);
+            std::memcpy(bytes, file.data(), size);
+            std::memset(bytes + size, 0, sizeof(TChar));
+            bytes += size + sizeof(TChar);
+        }
+
+        std::memset(bytes, 0, sizeof(TChar));
+    }
+
+private:
+    static constexpr size_t MaxCharCount = (UINT32_MAX / 2) / sizeof(TChar);
+
+    std::vector<StringView> m_files;
+    size_t m_charCount{};
+};
+
+} // namespace msf
@@ -51,12 +51,15 @@ class EnumFORMATETC :
 public:
     using FormatEtcs = std::vector<FORMATETC>;
 
+    // Note: the collection is shared by the enumerator and its clones and must not be modified after creation.
+    //       This allows to serve a cached snapshot of formats without copying it for every enumerator.
+
     EnumFORMATETC(const EnumFORMATETC&) = delete;
     EnumFORMATETC(EnumFORMATETC&&) = delete;
     EnumFORMATETC& operator=(const EnumFORMATETC&) = delete;
     EnumFORMATETC& operator=(EnumFORMATETC&&) = delete;
 
-    static ATL::CComPtr<EnumFORMATETC> CreateInstance(std::unique_ptr<FormatEtcs> formatEtcs)
+    static ATL::CComPtr<EnumFORMATETC> CreateInstance(std::shared_ptr<FormatEtcs> formatEtcs)
     {
         ATL::CComObject<EnumFORMATETC>* enumFormatEtc;
         RaiseExceptionIfFailed(ATL::CComObject<EnumFORMATETC>::CreateInstance(&enumFormatEtc));
@@ -79,15 +82,70 @@ class EnumFORMATETC :
     }
 
 private:
-    void Initialize(std::unique_ptr<FormatEtcs> formatEtcs) noexcept
+    // Purpose: owner of the shared collection, passed as pUnkForRelease to CComEnumOnSTL::Init.
+    //          The enumerator and its clones keep a reference to it. The enumerator cannot be its own owner:
+    //          that reference would prevent that the reference count ever drops to 0.
+    class FormatEtcsOwner final : public IUnknown
+    {
+    public:
+        explicit FormatEtcsOwner(std::shared_ptr<FormatEtcs> formatEtcs) noexcept :
+            m_formatEtcs{std::move(formatEtcs)}
+        {
+        }
+
+        FormatEtcsOwner(const FormatEtcsOwner&) = delete;
+        FormatEtcsOwner(FormatEtcsOwner&&) = delete;
+        FormatEtcsOwner& operator=(const FormatEtcsOwner&) = delete;
+        FormatEtcsOwner& operator=(FormatEtcsOwner&&) = delete;
+
+        HRESULT __stdcall QueryInterface(REFIID interfaceId, void** object) noexcept override
+        {
+            if (interfaceId != IID_IUnknown)
+            {
+                *object = nullptr;
+                return E_NOINTERFACE;
+            }
+
+            *object = static_cast<IUnknown*>(this);
+            AddRef();
+            return S_OK;
+        }
+
+        ULONG __stdcall AddRef() noexcept override
+        {
+            return static_cast<ULONG>(InterlockedIncrement(&m_referenceCount));
+        }
+
+        ULONG __stdcall Release() noexcept override
+        {
+            const auto referenceCount = static_cast<ULONG>(InterlockedDecrement(&m_referenceCount));
+            if (referenceCount == 0)
+            {
+                delete this;
+            }
+
+            return referenceCount;
+        }
+
+        [[nodiscard]] FormatEtcs& GetFormatEtcs() const noexcept
+        {
+            return *m_formatEtcs;
+        }
+
+    private:
+        ~FormatEtcsOwner() = default;
+
+        std::shared_ptr<FormatEtcs> m_formatEtcs;
+        LONG m_referenceCount{1};
+    };
+
+    void Initialize(std::shared_ptr<FormatEtcs> formatEtcs)
     {
-        m_formatEtcs = std::move(formatEtcs);
+        ATL::CComPtr<FormatEtcsOwner> owner;
+        owner.Attach(new FormatEtcsOwner(std::move(formatEtcs)));
 
-        ATLVERIFY(SUCCEEDED(__super::Init(this, *m_formatEtcs)));
+        ATLVERIFY(SUCCEEDED(__super::Init(owner, owner->GetFormatEtcs())));
     }
-
-    // Member variables.
-    std::unique_ptr<FormatEtcs> m_formatEtcs;
 };
 
 
@@ -6,6 +6,16 @@
 #pragma once
 
 #include "msf_base.h"
+#include "pidl.h"
+#include "spsc_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace msf
 {
@@ -73,25 +83,15 @@ class __declspec(novtable) IEnumIDListImpl :
             if (!pceltFetched && celt != 1)
                 return E_INVALIDARG;
 
-            CItemIdListVector itemidlistvector(reinterpret_cast<LPITEMIDLIST*>(ppidl));
-
-            for (ULONG i = 0; i < celt; ++i)
-            {
-                LPITEMIDLIST pidl = static_cast<T*>(this)->GetNextItem();
-                if (!pidl)
-                    break; // No more items.
-
-                itemidlistvector.push_back(pidl);
-            }
+            ReadItems(GetReadCount(celt));
+            const ULONG fetched = GetSnapshotItems(ppidl, celt);
 
             if (pceltFetched)
             {
-                *pceltFetched = itemidlistvector.size();
+                *pceltFetched = fetched;
             }
 
-            itemidlistvector.release();
-
-            return celt == itemidlistvector.size() ? S_OK : S_FALSE;
+            return celt == fetched ? S_OK : S_FALSE;
         }
         catch (...)
         {
@@ -99,22 +99,78 @@ class __declspec(novtable) IEnumIDListImpl :
         }
     }
 
-    HRESULT __stdcall Skip(ULONG /*celt*/) noexcept override
+    // Note: Skip, Reset and Clone are not used by explorer \ system folder view, but by other hosts that re-walk the enumerator.
+    //       Every item that is read from the storage is recorded in a snapshot, Next returns copies of the snapshot.
+    //       This makes it possible to Reset the enumerator at any moment without reading the storage again.
+    HRESULT __stdcall Skip(ULONG celt) noexcept override
     {
-        // Note: function not used by explorer \ system folder view.
-        ATLTRACENOTIMPL(L"IEnumIDListImpl::Skip");
+        try
+        {
+            ReadItems(GetReadCount(celt));
+
+            const size_t skipped = std::min(size_t{celt}, m_snapshot->items.size() - m_position);
+            m_position += skipped;
+
+            return celt == skipped ? S_OK : S_FALSE;
+        }
+        catch (...)
+        {
+            return ExceptionToHResult();
+        }
     }
 
     HRESULT __stdcall Reset() noexcept override
     {
-        // Note: function not used by explorer \ system folder view.
-        ATLTRACENOTIMPL(L"IEnumIDListImpl::Reset");
+        m_position = 0;
+        return S_OK;
+    }
+
+    HRESULT __stdcall Clone(__RPC__deref_out_opt IEnumIDList** ppenum) noexcept override
+    {
+        try
+        {
+            if (!ppenum)
+                return E_POINTER;
+
+            *ppenum = nullptr;
+
+            // Note: the clone shares the snapshot, which must be complete (and thus immutable) before it can be shared.
+            ReadItems(SIZE_MAX);
+
+            ATL::CComObject<T>* instance;
+            RaiseExceptionIfFailed(ATL::CComObject<T>::CreateInstance(&instance));
+            ATL::CComPtr<IEnumIDList> enumIdList(instance);
+
+            instance->m_snapshot = m_snapshot;
+            instance->m_position = m_position;
+
+            *ppenum = enumIdList.Detach();
+            return S_OK;
+        }
+        catch (...)
+        {
+            return ExceptionToHResult();
+        }
     }
 
-    HRESULT __stdcall Clone(__RPC__deref_out_opt IEnumIDList** /*enum*/) override
+    // Purpose: retrieves up to 'count' items. Returning less than 'count' items signals the end of the enumeration.
+    //          The default implementation calls GetNextItem for every item. Override this function
+    //          when the storage of the items can produce them more efficiently in a batch.
+    ULONG GetNextItems(PITEMID_CHILD* items, ULONG count)
     {
-        // Note: function not used by explorer \ system folder view.
-        ATLTRACENOTIMPL(L"IEnumIDListImpl::Clone");
+        CItemIdListVector itemidlistvector(reinterpret_cast<LPITEMIDLIST*>(items));
+
+        for (ULONG i = 0; i < count && !IsCancelled(); ++i)
+        {
+            LPITEMIDLIST pidl = static_cast<T*>(this)->GetNextItem();
+            if (!pidl)
+                break; // No more items.
+
+            itemidlistvector.push_back(pidl);
+        }
+
+        itemidlistvector.release();
+        return itemidlistvector.size();
     }
 
 protected:
@@ -126,7 +182,248 @@ class __declspec(novtable) IEnumIDListImpl :
     ~IEnumIDListImpl()
     {
         ATLTRACE(L"IEnumIDListImpl::~IEnumIDListImpl (instance=%p)\n", this);
+        ATLASSERT(!m_prefetch && "StopPrefetch must be called by FinalRelease, the worker thread uses the derived class");
+    }
+
+    // Purpose: starts a worker thread that retrieves items (with GetNextItems) ahead of the consumer (opt-in).
+    //          Next will then return items that are already created.
+    //          Call this function when the derived class is initialized and call StopPrefetch in FinalRelease.
+    void StartPrefetch()
+    {
+        ATLASSERT(!m_prefetch && "Prefetch already started");
+
+        auto prefetch = std::make_unique<Prefetch>();
+        prefetch->thread = std::thread([this, &state = *prefetch] { ProducePrefetchItems(state); });
+        m_prefetch = std::move(prefetch);
+    }
+
+    // Purpose: stops the enumeration when the flag is set, see ShellFolderViewCBImpl::GetEnumCancellation.
+    void SetCancellation(std::shared_ptr<const std::atomic<bool>> cancelled) noexcept
+    {
+        ATLASSERT(!m_prefetch && "Set the cancellation before the prefetch is started");
+        m_cancelled = std::move(cancelled);
+    }
+
+    // Purpose: cancels the worker thread and releases the items that were not retrieved.
+    void StopPrefetch() noexcept
+    {
+        if (!m_prefetch)
+            return;
+
+        {
+            std::lock_guard lock(m_prefetch->mutex);
+            m_prefetch->stop = true;
+        }
+        m_prefetch->spaceAvailable.notify_one();
+        m_prefetch->thread.join();
+
+        PITEMID_CHILD pidl;
+        while (m_prefetch->ring.TryPop(pidl))
+        {
+            CoTaskMemFree(pidl);
+        }
+
+        m_prefetch.reset();
+    }
+
+private:
+    static constexpr ULONG PrefetchBatchSize = 64;
+
+    // Purpose: the items read from the storage. A complete snapshot is immutable and shared by an enumerator and its clones.
+    struct Snapshot final
+    {
+        Snapshot() = default;
+        Snapshot(const Snapshot&) = delete;
+        Snapshot(Snapshot&&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+
+        ~Snapshot()
+        {
+            for (auto pidl : items)
+            {
+                CoTaskMemFree(pidl);
+            }
+        }
+
+        std::vector<PITEMID_CHILD> items;
+        bool complete{}; // true if all items have been read.
+    };
+
+    struct Prefetch final
+    {
+        SpscRing<PITEMID_CHILD, 256> ring;
+        std::mutex mutex; // only used to wait: the ring itself is lock-free.
+        std::condition_variable itemsAvailable;
+        std::condition_variable spaceAvailable;
+        std::atomic<bool> done{};
+        std::atomic<bool> stop{}; // written with the mutex locked, also read without it by the producer.
+        HRESULT result{S_OK};
+        std::thread thread;
+    };
+
+    void ProducePrefetchItems(Prefetch& prefetch) noexcept
+    {
+        PITEMID_CHILD batch[PrefetchBatchSize];
+
+        try
+        {
+            for (;;)
+            {
+                if (prefetch.stop.load(std::memory_order_relaxed) || IsCancelled())
+                    break;
+
+                const ULONG count = static_cast<T*>(this)->GetNextItems(batch, PrefetchBatchSize);
+                for (ULONG i = 0; i < count; ++i)
+                {
+                    if (!PushPrefetchItem(prefetch, batch[i]))
+                    {
+                        // Cancelled: release the items that could not be stored.
+                        for (; i < count; ++i)
+                        {
+                            CoTaskMemFree(batch[i]);
+                        }
+                        return;
+                    }
+                }
+
+                // Note: the empty lock prevents a lost wake-up of a consumer that is about to wait.
+                {
+                    std::lock_guard lock(prefetch.mutex);
+                }
+                prefetch.itemsAvailable.notify_one();
+
+                if (count < PrefetchBatchSize)
+                    break;
+            }
+        }
+        catch (...)
+        {
+            prefetch.result = ExceptionToHResult();
+        }
+
+        {
+            std::lock_guard lock(prefetch.mutex);
+            prefetch.done = true;
+        }
+        prefetch.itemsAvailable.notify_one();
     }
+
+    // Purpose: stores an item in the ring, waits when the ring is full. Returns false when cancelled.
+    static bool PushPrefetchItem(Prefetch& prefetch, PITEMID_CHILD pidl)
+    {
+        while (!prefetch.ring.TryPush(pidl))
+        {
+            std::unique_lock lock(prefetch.mutex);
+            prefetch.itemsAvailable.notify_one();
+            prefetch.spaceAvailable.wait(lock, [&prefetch] { return prefetch.stop || !prefetch.ring.IsFull(); });
+            if (prefetch.stop)
+                return false;
+        }
+
+        return true;
+    }
+
+    ULONG FetchItems(PITEMID_CHILD* items, ULONG count)
+    {
+        if (IsCancelled())
+            return 0;
+
+        return m_prefetch ? GetPrefetchedItems(items, count) : static_cast<T*>(this)->GetNextItems(items, count);
+    }
+
+    [[nodiscard]] bool IsCancelled() const noexcept
+    {
+        return m_cancelled && m_cancelled->load(std::memory_order_relaxed);
+    }
+
+    // Purpose: the number of items the snapshot must contain to return 'count' items from the current position.
+    [[nodiscard]] size_t GetReadCount(ULONG count) const noexcept
+    {
+        return m_position + std::min(size_t{count}, SIZE_MAX - m_position);
+    }
+
+    // Purpose: reads items from the storage into the snapshot until it contains 'count' items or all items.
+    void ReadItems(size_t count)
+    {
+        if (!m_snapshot)
+        {
+            m_snapshot = std::make_shared<Snapshot>();
+        }
+
+        auto& snapshot = *m_snapshot;
+        while (!snapshot.complete && snapshot.items.size() < count)
+        {
+            const size_t offset = snapshot.items.size();
+            const auto batchSize = static_cast<ULONG>(std::min(count - offset, size_t{PrefetchBatchSize}));
+            snapshot.items.resize(offset + batchSize);
+            ULONG fetched;
+            try
+            {
+                fetched = FetchItems(snapshot.items.data() + offset, batchSize);
+            }
+            catch (...)
+            {
+                snapshot.items.resize(offset); // the failed batch is already released.
+                throw;
+            }
+
+            snapshot.items.resize(offset + fetched);
+            snapshot.complete = fetched < batchSize;
+        }
+    }
+
+    ULONG GetSnapshotItems(PITEMID_CHILD* items, ULONG count)
+    {
+        CItemIdListVector itemidlistvector(reinterpret_cast<LPITEMIDLIST*>(items));
+
+        const auto& snapshotItems = m_snapshot->items;
+        for (; itemidlistvector.size() < count && m_position < snapshotItems.size(); ++m_position)
+        {
+            itemidlistvector.push_back(ItemIDList::Clone(snapshotItems[m_position]));
+        }
+
+        itemidlistvector.release();
+        return itemidlistvector.size();
+    }
+
+    ULONG GetPrefetchedItems(PITEMID_CHILD* items, ULONG count)
+    {
+        auto& prefetch = *m_prefetch;
+
+        ULONG fetched = 0;
+        while (fetched < count)
+        {
+            if (prefetch.ring.TryPop(items[fetched]))
+            {
+                ++fetched;
+                continue;
+            }
+
+            std::unique_lock lock(prefetch.mutex);
+            prefetch.spaceAvailable.notify_one();
+            prefetch.itemsAvailable.wait(lock, [&prefetch] { return prefetch.done || !prefetch.ring.IsEmpty(); });
+            if (prefetch.done && prefetch.ring.IsEmpty())
+                break;
+        }
+
+        {
+            std::lock_guard lock(prefetch.mutex);
+        }
+        prefetch.spaceAvailable.notify_one();
+
+        if (fetched == 0 && prefetch.done)
+        {
+            RaiseExceptionIfFailed(prefetch.result);
+        }
+
+        return fetched;
+    }
+
+    std::unique_ptr<Prefetch> m_prefetch;
+    std::shared_ptr<const std::atomic<bool>> m_cancelled;
+    std::shared_ptr<Snapshot> m_snapshot;
+    size_t m_position{};
 };
 
 } // namespace msf
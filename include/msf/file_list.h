@@ -6,10 +6,15 @@
 #pragma once
 
 
-#include "msfbase.h"
-#include "stgmedium.h"
+#include "msf_base.h"
+#include "drop_files.h"
+#include "util.h"
+
 #include <atlctl.h>
 
+#include <string>
+#include <vector>
+
 
 namespace msf
 {
@@ -72,39 +77,18 @@ class FileList :
         RaiseExceptionIf(formatEtc->tymed != TYMED_HGLOBAL, DV_E_TYMED);
     }
 
-    uint32_t HGLOBAL CreateData() const
-    {
-        const HGLOBAL hg = GlobalAllocThrow(GetDataSize());
-
-        DROPFILES* dropFiles = static_cast<DROPFILES*>(hg);
-
-        dropFiles->pFiles = sizeof(DROPFILES);
-        dropFiles->fWide = true;
-
-        // copy filenames into data block.
-        wchar_t* pszBuf = reinterpret_cast<wchar_t*>(reinterpret_cast<BYTE*>(dropFiles) +sizeof(DROPFILES));
-
-        for (auto fileName : m_filenames)
-        {
-            ATLVERIFY(lstrcpy(pszBuf, fileName.c_str()));
-            pszBuf += fileName.GetLength() + 1;
-        }
-
-        *pszBuf = L'\0';
-
-        return hg;
-    }
-
-    size_t GetDataSize() const
+    // Purpose: creates the DROPFILES block in 1 pass, the size is known before the memory is allocated.
+    HGLOBAL CreateData() const
     {
-        uint32_t char_count{};
-
+        DropFilesBuilder<> builder(m_filenames.size());
         for (const auto& fileName : m_filenames)
         {
-            char_count += fileName.GetLength() + 1;
+            builder.Add(fileName);
         }
 
-        return sizeof(DROPFILES) + (sizeof(wchar_t) * (char_count + 1));
+        const HGLOBAL hg = GlobalAllocThrow(builder.GetSize());
+        builder.Write(hg); // GMEM_FIXED: the handle is the pointer.
+        return hg;
     }
 
     std::vector<std::wstring> m_filenames;
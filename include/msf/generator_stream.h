@@ -0,0 +1,286 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+#include "msf_base.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace msf
+{
+
+/// <summary>Read-only IStream that produces its content on demand.</summary>
+/// <remarks>
+/// The content is requested from the reader in chunks of ChunkSize bytes (aligned on the chunk size),
+/// only 1 chunk is kept in memory, independent of the size of the stream. This makes it possible to
+/// provide large virtual files (CFSTR_FILECONTENTS) without creating the complete content up front.
+/// An instance is not meant for concurrent use, Clone creates an independent stream that shares the reader.
+/// </remarks>
+class __declspec(novtable) GeneratorStream :
+    public ATL::CComObjectRootEx<ATL::CComMultiThreadModel>,
+    public IStream
+{
+public:
+    // Purpose: fills 'buffer' with 'size' bytes of content, starting at 'offset'.
+    //          The requested range is never beyond the end of the stream and never larger than ChunkSize.
+    using Reader = std::function<void(uint64_t offset, std::byte* buffer, size_t size)>;
+
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    BEGIN_COM_MAP(GeneratorStream)
+        COM_INTERFACE_ENTRY(IStream)
+        COM_INTERFACE_ENTRY(ISequentialStream)
+    END_COM_MAP()
+
+    GeneratorStream(const GeneratorStream&) = delete;
+    GeneratorStream(GeneratorStream&&) = delete;
+    GeneratorStream& operator=(const GeneratorStream&) = delete;
+    GeneratorStream& operator=(GeneratorStream&&) = delete;
+
+    // Purpose: creates a stream of 'size' bytes, the name is returned by Stat.
+    static ATL::CComPtr<IStream> CreateInstance(uint64_t size, Reader reader, std::wstring name = std::wstring())
+    {
+        return CreateInstance(std::make_shared<const Source>(Source{size, std::move(reader), std::move(name)}), 0);
+    }
+
+    // ISequentialStream
+    HRESULT __stdcall Read(_Out_writes_bytes_to_(cb, *pcbRead) void* pv, ULONG cb, _Out_opt_ ULONG* pcbRead) noexcept override
+    {
+        try
+        {
+            auto* buffer = static_cast<std::byte*>(pv);
+            ULONG read = 0;
+            while (read < cb && m_position < m_source->size)
+            {
+                const std::byte* chunk = GetChunk(m_position);
+                const auto offsetInChunk = static_cast<size_t>(m_position - m_chunkOffset);
+                const auto count = static_cast<ULONG>(std::min(size_t{cb - read}, m_chunkSize - offsetInChunk));
+                std::copy_n(chunk + offsetInChunk, count, buffer + read);
+                read += count;
+                m_position += count;
+            }
+
+            if (pcbRead)
+            {
+                *pcbRead = read;
+            }
+
+            return read == cb ? S_OK : S_FALSE;
+        }
+        catch (...)
+        {
+            if (pcbRead)
+            {
+                *pcbRead = 0;
+            }
+
+            return ExceptionToHResult();
+        }
+    }
+
+    HRESULT __stdcall Write(_In_reads_bytes_(cb) const void*, ULONG cb, _Out_opt_ ULONG* pcbWritten) noexcept override
+    {
+        ATLTRACE(L"GeneratorStream::Write (cb=%d), stream is read-only\n", cb);
+        if (pcbWritten)
+        {
+            *pcbWritten = 0;
+        }
+
+        return STG_E_ACCESSDENIED;
+    }
+
+    // IStream
+    HRESULT __stdcall Seek(LARGE_INTEGER move, DWORD origin, _Out_opt_ ULARGE_INTEGER* newPosition) noexcept override
+    {
+        int64_t base;
+        switch (origin)
+        {
+        case STREAM_SEEK_SET:
+            base = 0;
+            break;
+
+        case STREAM_SEEK_CUR:
+            base = static_cast<int64_t>(m_position);
+            break;
+
+        case STREAM_SEEK_END:
+            base = static_cast<int64_t>(m_source->size);
+            break;
+
+        default:
+            return STG_E_INVALIDFUNCTION;
+        }
+
+        const int64_t position = base + move.QuadPart;
+        if (position < 0)
+            return STG_E_INVALIDFUNCTION;
+
+        // Note: seeking beyond the end is allowed, Read will then return 0 bytes.
+        m_position = static_cast<uint64_t>(position);
+        if (newPosition)
+        {
+            newPosition->QuadPart = m_position;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT __stdcall SetSize(ULARGE_INTEGER) noexcept override
+    {
+        return STG_E_ACCESSDENIED;
+    }
+
+    HRESULT __stdcall CopyTo(_In_ IStream* stream, ULARGE_INTEGER cb, _Out_opt_ ULARGE_INTEGER* pcbRead, _Out_opt_ ULARGE_INTEGER* pcbWritten) noexcept override
+    {
+        try
+        {
+            uint64_t read = 0;
+            uint64_t written = 0;
+            HRESULT result = S_OK;
+            while (read < cb.QuadPart && m_position < m_source->size)
+            {
+                const std::byte* chunk = GetChunk(m_position);
+                const auto offsetInChunk = static_cast<size_t>(m_position - m_chunkOffset);
+                const auto count = static_cast<ULONG>(std::min(cb.QuadPart - read, uint64_t{m_chunkSize - offsetInChunk}));
+
+                // Note: only advance past the bytes that were written, a failed or short write leaves the rest unread.
+                ULONG chunkWritten = 0;
+                result = stream->Write(chunk + offsetInChunk, count, &chunkWritten);
+                chunkWritten = std::min(chunkWritten, count);
+                m_position += chunkWritten;
+                read += chunkWritten;
+                written += chunkWritten;
+                if (FAILED(result) || chunkWritten < count)
+                    break;
+            }
+
+            if (pcbRead)
+            {
+                pcbRead->QuadPart = read;
+            }
+
+            if (pcbWritten)
+            {
+                pcbWritten->QuadPart = written;
+            }
+
+            return result;
+        }
+        catch (...)
+        {
+            return ExceptionToHResult();
+        }
+    }
+
+    HRESULT __stdcall Commit(DWORD) noexcept override
+    {
+        return S_OK; // nothing to commit, the stream is read-only.
+    }
+
+    HRESULT __stdcall Revert() noexcept override
+    {
+        return S_OK;
+    }
+
+    HRESULT __stdcall LockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) noexcept override
+    {
+        return STG_E_INVALIDFUNCTION;
+    }
+
+    HRESULT __stdcall UnlockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) noexcept override
+    {
+        return STG_E_INVALIDFUNCTION;
+    }
+
+    HRESULT __stdcall Stat(__RPC__out STATSTG* statstg, DWORD statFlag) noexcept override
+    {
+        *statstg = STATSTG();
+        statstg->type = STGTY_STREAM;
+        statstg->cbSize.QuadPart = m_source->size;
+        statstg->grfMode = STGM_READ;
+
+        if (!IsBitSet(statFlag, STATFLAG_NONAME) && !m_source->name.empty())
+        {
+            const size_t size = (m_source->name.size() + 1) * sizeof(wchar_t);
+            statstg->pwcsName = static_cast<LPOLESTR>(CoTaskMemAlloc(size));
+            if (!statstg->pwcsName)
+                return E_OUTOFMEMORY;
+
+            memcpy(statstg->pwcsName, m_source->name.c_str(), size);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT __stdcall Clone(__RPC__deref_out_opt IStream** stream) noexcept override
+    {
+        try
+        {
+            *stream = CreateInstance(m_source, m_position).Detach();
+            return S_OK;
+        }
+        catch (...)
+        {
+            *stream = nullptr;
+            return ExceptionToHResult();
+        }
+    }
+
+protected:
+    GeneratorStream() noexcept(false) = default; // noexcept(false) needed as ATL base class is not defined noexcept.
+    ~GeneratorStream() = default;
+
+private:
+    struct Source
+    {
+        uint64_t size;
+        Reader reader;
+        std::wstring name;
+    };
+
+    static ATL::CComPtr<IStream> CreateInstance(std::shared_ptr<const Source> source, uint64_t position)
+    {
+        ATL::CComObject<GeneratorStream>* instance;
+        RaiseExceptionIfFailed(ATL::CComObject<GeneratorStream>::CreateInstance(&instance));
+
+        ATL::CComPtr<IStream> stream(instance);
+        instance->m_source = std::move(source);
+        instance->m_position = position;
+        return stream;
+    }
+
+    // Purpose: returns the chunk that contains 'position', the reader is only called when the position is outside the current chunk.
+    const std::byte* GetChunk(uint64_t position)
+    {
+        if (m_chunkSize != 0 && position >= m_chunkOffset && position - m_chunkOffset < m_chunkSize)
+            return m_chunk.get();
+
+        if (!m_chunk)
+        {
+            m_chunk = std::make_unique<std::byte[]>(static_cast<size_t>(std::min(m_source->size, uint64_t{ChunkSize})));
+        }
+
+        m_chunkOffset = position - (position % ChunkSize);
+        m_chunkSize = 0; // invalid until the reader succeeded.
+        const auto chunkSize = static_cast<size_t>(std::min(m_source->size - m_chunkOffset, uint64_t{ChunkSize}));
+        m_source->reader(m_chunkOffset, m_chunk.get(), chunkSize);
+        m_chunkSize = chunkSize;
+        return m_chunk.get();
+    }
+
+    // Member variables.
+    std::shared_ptr<const Source> m_source;
+    uint64_t m_position{};
+    std::unique_ptr<std::byte[]> m_chunk;
+    uint64_t m_chunkOffset{};
+    size_t m_chunkSize{};
+};
+
+} // namespace msf
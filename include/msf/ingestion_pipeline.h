@@ -0,0 +1,116 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library).
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <execution>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace msf
+{
+
+/// <summary>Adds a set of sources (for example dropped files) to a store in 3 stages: prepare, commit and publish.</summary>
+/// <remarks>
+/// Stage 1 prepares a record per source (stat or read the source) in parallel, on the thread pool of the
+/// parallel algorithms; Prepare must be thread safe. The sources are prepared in batches of BatchSize, after
+/// every batch the progress callback is called on the calling thread, it can cancel the operation before
+/// anything is committed. Stage 2 commits all records with 1 call (1 write action of the store) and stage 3
+/// publishes the result with 1 call (1 change notification). Both run on the calling thread.
+/// </remarks>
+template <typename TSource, typename TRecord>
+class IngestionPipeline final
+{
+public:
+    static_assert(std::is_default_constructible_v<TRecord>, "records are prepared in place");
+
+    // Purpose: stage 1, creates the record of a source. Called concurrently.
+    using Prepare = std::function<TRecord(const TSource& source)>;
+
+    // Purpose: stage 2, stores all prepared records.
+    using Commit = std::function<void(std::vector<TRecord>& records)>;
+
+    // Purpose: stage 3, publishes the committed records.
+    using Publish = std::function<void(const std::vector<TRecord>& records)>;
+
+    // Purpose: called after every prepared batch, return false to cancel.
+    using Progress = std::function<bool(size_t completed, size_t total)>;
+
+    static constexpr size_t BatchSize = 256;
+
+    IngestionPipeline(Prepare prepare, Commit commit, Publish publish) :
+        m_prepare{std::move(prepare)},
+        m_commit{std::move(commit)},
+        m_publish{std::move(publish)}
+    {
+    }
+
+    void SetProgress(Progress progress)
+    {
+        m_progress = std::move(progress);
+    }
+
+    // Purpose: runs the 3 stages, returns false when the operation was cancelled (nothing is committed).
+    //          An exception of Prepare is rethrown on the calling thread, before anything is committed.
+    bool Run(const std::vector<TSource>& sources) const
+    {
+        std::vector<TRecord> records(sources.size());
+        for (size_t first = 0; first < sources.size(); first += BatchSize)
+        {
+            const size_t last = std::min(first + BatchSize, sources.size());
+            PrepareBatch(sources, records, first, last);
+
+            if (m_progress && !m_progress(last, sources.size()))
+                return false;
+        }
+
+        m_commit(records);
+        m_publish(records);
+        return true;
+    }
+
+private:
+    // Note: exceptions cannot leave a parallel algorithm (std::terminate), the first one is captured and rethrown.
+    void PrepareBatch(const std::vector<TSource>& sources, std::vector<TRecord>& records, size_t first, size_t last) const
+    {
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        const auto begin = records.begin() + static_cast<std::ptrdiff_t>(first);
+        const auto end = records.begin() + static_cast<std::ptrdiff_t>(last);
+        std::for_each(std::execution::par, begin, end, [this, &sources, &records, &error, &errorMutex](TRecord& record) noexcept {
+            try
+            {
+                record = m_prepare(sources[static_cast<size_t>(&record - records.data())]);
+            }
+            catch (...)
+            {
+                std::lock_guard lock(errorMutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        });
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    Prepare m_prepare;
+    Commit m_commit;
+    Publish m_publish;
+    Progress m_progress;
+};
+
+} // namespace msf
@@ -27,7 +27,12 @@
 #include "property_sheet.h"
 #include "str_util.h"
 #include "cf_hdrop.h"
+#include "change_notify_batcher.h"
 #include "pidl.h"
+#include "pidl_schema.h"
+#include "pidl_compare.h"
+#include "pidl_hash.h"
+#include "pidl_intern_table.h"
 #include "util.h"
 #include "menu.h"
 #include "context_command.h"
@@ -36,4 +41,6 @@
 #include "version.h"
 #include "item_base.h"
 #include "cf_handler.h"
+#include "generator_stream.h"
+#include "ingestion_pipeline.h"
 #include "image_list_index.h"
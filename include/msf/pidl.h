@@ -6,41 +6,67 @@
 #pragma once
 
 #include "msf_base.h"
+#include "pidl_allocator.h"
+
+#include <type_traits>
 
 namespace msf
 {
 
-// Purpose: Management class for pidls. A CPidl class is owner of the wrapped ITEMIDLIST.
-class ItemIDList final
+// Purpose: Management class for pidls. A BasicItemIDList class is owner of the wrapped ITEMIDLIST.
+//          The allocator policy controls how the ITEMIDLIST memory is allocated and freed.
+//          Use ItemIDList for PIDLs that cross the COM boundary and TransientItemIDList for
+//          short-lived PIDLs that are only used inside the framework.
+template<typename TAllocator>
+class BasicItemIDList final
 {
 public:
     static PIDLIST_RELATIVE Clone(_In_ PCUIDLIST_RELATIVE pidlSrc)
     {
         ATLASSERT(pidlSrc && "Why clone a NULL pointer?");
 
-        const PIDLIST_RELATIVE pidl = ILClone(pidlSrc);
-        RaiseExceptionIf(!pidl, E_OUTOFMEMORY);
+        const uint32_t size = ILGetSize(pidlSrc);
+        auto const pidl = static_cast<PIDLIST_RELATIVE>(TAllocator::Allocate(size));
+        memcpy(pidl, pidlSrc, size);
         return pidl;
     }
 
     static PIDLIST_ABSOLUTE CloneFull(_In_ PCUIDLIST_ABSOLUTE pidlSrc)
     {
-        ATLASSERT(pidlSrc && "Why clone a NULL pointer?");
-
-        const PIDLIST_ABSOLUTE pidl = ILCloneFull(pidlSrc);
-        RaiseExceptionIf(!pidl, E_OUTOFMEMORY);
-        return pidl;
+        return static_cast<PIDLIST_ABSOLUTE>(Clone(pidlSrc));
     }
 
     static PIDLIST_ABSOLUTE Combine(_In_opt_ PCIDLIST_ABSOLUTE pidl1, _In_opt_ PCUIDLIST_RELATIVE pidl2)
     {
-        PIDLIST_ABSOLUTE const pidl = ILCombine(pidl1, pidl2); // -V595
-        RaiseExceptionIf(!pidl && !(pidl1 == nullptr && pidl2 == nullptr), E_OUTOFMEMORY);
-        return pidl;
+        // Note: same semantics as ILCombine: NULL + NULL = NULL, a single NULL results in a clone of the other.
+        if (!pidl1 && !pidl2)
+            return nullptr;
+
+        const uint32_t size1 = pidl1 ? ILGetSize(pidl1) - static_cast<uint32_t>(sizeof(USHORT)) : 0;
+        const uint32_t size2 = pidl2 ? ILGetSize(pidl2) : static_cast<uint32_t>(sizeof(USHORT));
+
+        auto* const p = static_cast<BYTE*>(TAllocator::Allocate(size1 + size2));
+        if (pidl1)
+        {
+            memcpy(p, pidl1, size1);
+        }
+
+        if (pidl2)
+        {
+            memcpy(p + size1, pidl2, size2);
+        }
+        else
+        {
+            reinterpret_cast<SHITEMID*>(p + size1)->cb = 0;
+        }
+
+        return reinterpret_cast<PIDLIST_ABSOLUTE>(p);
     }
 
     static LPITEMIDLIST CreateFromPath(PCWSTR pszPath)
     {
+        static_assert(std::is_same_v<TAllocator, TaskMemAllocator>, "ILCreateFromPath uses the COM task allocator");
+
         const LPITEMIDLIST pidl = ILCreateFromPath(pszPath);
         RaiseExceptionIf(!pidl, E_OUTOFMEMORY);
         return pidl;
@@ -50,9 +76,7 @@ class ItemIDList final
     {
         const size_t size = sizeof(short) + sizeItem;
 
-        auto const pidl = static_cast<PUIDLIST_RELATIVE>(CoTaskMemAlloc(size + sizeof(short)));
-        if (!pidl)
-            RaiseException(E_OUTOFMEMORY);
+        auto const pidl = static_cast<PUIDLIST_RELATIVE>(TAllocator::Allocate(size + sizeof(short)));
 
         LPSHITEMID const shellItemId = &(pidl->mkid);
         shellItemId->cb = static_cast<USHORT>(size);
@@ -76,46 +100,48 @@ class ItemIDList final
         return pidlNext;
     }
 
-    ItemIDList() = default;
+    BasicItemIDList() = default;
 
-    explicit ItemIDList(PUIDLIST_RELATIVE itemIDList) noexcept
+    explicit BasicItemIDList(PUIDLIST_RELATIVE itemIDList) noexcept
         : m_pidl(static_cast<LPITEMIDLIST>(itemIDList))
     {
     }
 
-    ItemIDList(_In_opt_ PCIDLIST_ABSOLUTE pidl1, _In_opt_ PCUIDLIST_RELATIVE pidl2)
+    BasicItemIDList(_In_opt_ PCIDLIST_ABSOLUTE pidl1, _In_opt_ PCUIDLIST_RELATIVE pidl2)
         : m_pidl(Combine(pidl1, pidl2))
     {
     }
 
-    ItemIDList(const ItemIDList& pidl1, PCUIDLIST_RELATIVE pidl2)
+    template<typename TOtherAllocator>
+    BasicItemIDList(const BasicItemIDList<TOtherAllocator>& pidl1, PCUIDLIST_RELATIVE pidl2)
         : m_pidl(Combine(pidl1.GetAbsolute(), pidl2))
     {
     }
 
-    ItemIDList(const ItemIDList& pidl1, const ItemIDList& pidl2)
+    template<typename TAllocator1, typename TAllocator2>
+    BasicItemIDList(const BasicItemIDList<TAllocator1>& pidl1, const BasicItemIDList<TAllocator2>& pidl2)
         : m_pidl(Combine(pidl1.GetAbsolute(), pidl2.GetRelative()))
     {
     }
 
-    explicit ItemIDList(PCWSTR pszPath)
+    explicit BasicItemIDList(PCWSTR pszPath)
         : m_pidl(CreateFromPath(pszPath))
     {
     }
 
-    ~ItemIDList()
+    ~BasicItemIDList()
     {
-        CoTaskMemFree(m_pidl);
+        TAllocator::Free(m_pidl);
     }
 
-    ItemIDList(const ItemIDList&) = delete;
-    ItemIDList(ItemIDList&&) = delete;
-    ItemIDList& operator=(const ItemIDList&) = delete;
-    ItemIDList& operator=(ItemIDList&&) = delete;
+    BasicItemIDList(const BasicItemIDList&) = delete;
+    BasicItemIDList(BasicItemIDList&&) = delete;
+    BasicItemIDList& operator=(const BasicItemIDList&) = delete;
+    BasicItemIDList& operator=(BasicItemIDList&&) = delete;
 
     void Attach(PUIDLIST_RELATIVE pidl) noexcept
     {
-        CoTaskMemFree(m_pidl);
+        TAllocator::Free(m_pidl);
         m_pidl = pidl;
     }
 
@@ -157,6 +183,8 @@ class ItemIDList final
 
     void AppendID(const SHITEMID* pmkid)
     {
+        static_assert(std::is_same_v<TAllocator, TaskMemAllocator>, "ILAppendID uses the COM task allocator");
+
         PIDLIST_RELATIVE const pidl = ILAppendID(GetRelative(), pmkid, true);
         RaiseExceptionIf(!pidl, E_OUTOFMEMORY);
 
@@ -202,7 +230,9 @@ class ItemIDList final
     // Purpose: Address operator to be used for passing address to be used as an out-parameter.
     [[nodiscard]] LPITEMIDLIST* operator&() noexcept
     {
-        CoTaskMemFree(m_pidl);
+        static_assert(std::is_same_v<TAllocator, TaskMemAllocator>, "out-parameters are allocated by the COM task allocator");
+
+        TAllocator::Free(m_pidl);
         m_pidl = nullptr;
         return &m_pidl;
     }
@@ -211,4 +241,7 @@ class ItemIDList final
     LPITEMIDLIST m_pidl{};
 };
 
+using ItemIDList = BasicItemIDList<TaskMemAllocator>;
+using TransientItemIDList = BasicItemIDList<TransientPidlAllocator>;
+
 } // namespace msf
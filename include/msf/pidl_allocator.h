@@ -0,0 +1,63 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+#include "msf_base.h"
+#include "slab_allocator.h"
+
+namespace msf
+{
+
+/// <summary>Allocator policy that uses the COM task allocator.</summary>
+/// <remarks>
+/// PIDLs that are passed to or received from the shell (COM boundary) must
+/// always be allocated with this policy.
+/// </remarks>
+class TaskMemAllocator final
+{
+public:
+    [[nodiscard]] static void* Allocate(size_t size)
+    {
+        void* p = CoTaskMemAlloc(size);
+        RaiseExceptionIf(!p, E_OUTOFMEMORY);
+        return p;
+    }
+
+    static void Free(void* p) noexcept
+    {
+        CoTaskMemFree(p);
+    }
+};
+
+
+/// <summary>Allocator policy for transient PIDLs that never leave the framework.</summary>
+/// <remarks>
+/// Uses a slab allocator per thread. A PIDL allocated with this policy must be
+/// freed on the same thread and may never be passed to a caller that will free it
+/// with CoTaskMemFree.
+/// </remarks>
+class TransientPidlAllocator final
+{
+public:
+    [[nodiscard]] static void* Allocate(size_t size)
+    {
+        return GetSlabAllocator().Allocate(size);
+    }
+
+    static void Free(void* p) noexcept
+    {
+        GetSlabAllocator().Free(p);
+    }
+
+private:
+    static SlabAllocator<TaskMemAllocator>& GetSlabAllocator() noexcept
+    {
+        thread_local SlabAllocator<TaskMemAllocator> slabAllocator;
+        return slabAllocator;
+    }
+};
+
+} // namespace msf
@@ -0,0 +1,69 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library),
+//       a SHITEMID is handled as a 16 bit size (cb, includes itself) followed by the data.
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace msf
+{
+
+/// <summary>Detects if an item type has a canonical binary identity.</summary>
+/// <remarks>
+/// An item type opts in by declaring: static constexpr bool HasCanonicalBinaryIdentity = true.
+/// This promises that 2 SHITEMIDs describe the same item if and only if they are byte-wise equal,
+/// which allows CompareIDs to answer SHCIDS_CANONICALONLY requests without creating items.
+/// Do not opt in when the data contains mutable properties or when older layouts are still accepted.
+/// </remarks>
+template<typename TItem, typename = void>
+struct HasCanonicalBinaryIdentity : std::false_type
+{
+};
+
+template<typename TItem>
+struct HasCanonicalBinaryIdentity<TItem, std::enable_if_t<TItem::HasCanonicalBinaryIdentity>> : std::true_type
+{
+};
+
+template<typename TItem>
+constexpr bool HasCanonicalBinaryIdentityV = HasCanonicalBinaryIdentity<TItem>::value;
+
+
+[[nodiscard]] inline uint16_t GetItemIdSize(const void* itemId) noexcept
+{
+    uint16_t size;
+    std::memcpy(&size, itemId, sizeof size);
+    return size;
+}
+
+
+// Purpose: returns true if 2 SHITEMIDs (size and data) are byte-wise equal.
+//          Items of different size are rejected before any data is read.
+[[nodiscard]] inline bool AreItemIdsBinaryEqual(const void* itemId1, const void* itemId2) noexcept
+{
+    const uint16_t size = GetItemIdSize(itemId1);
+    return size == GetItemIdSize(itemId2) && (itemId1 == itemId2 || std::memcmp(itemId1, itemId2, size) == 0);
+}
+
+
+// Purpose: byte-wise order of 2 SHITEMIDs, returns -1, 0 or 1.
+//          The order is consistent, but has no meaning beyond identity.
+[[nodiscard]] inline int CompareItemIdsBinary(const void* itemId1, const void* itemId2) noexcept
+{
+    const uint16_t size1 = GetItemIdSize(itemId1);
+    const uint16_t size2 = GetItemIdSize(itemId2);
+    if (size1 != size2)
+        return size1 < size2 ? -1 : 1;
+
+    const int result = std::memcmp(itemId1, itemId2, size1);
+    return (result > 0) - (result < 0);
+}
+
+} // namespace msf
@@ -0,0 +1,102 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library),
+//       a PIDL is handled as a chain of SHITEMIDs (16 bit cb followed by the data), terminated by a cb of 0.
+
+#include "pidl_compare.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace msf
+{
+
+// Purpose: returns the size of a PIDL in bytes, including the terminator (same result as ILGetSize).
+[[nodiscard]] inline size_t GetPidlSize(const void* pidl) noexcept
+{
+    const auto* bytes = static_cast<const std::byte*>(pidl);
+    size_t size = 0;
+    for (uint16_t itemIdSize = GetItemIdSize(bytes); itemIdSize != 0; itemIdSize = GetItemIdSize(bytes + size))
+    {
+        size += itemIdSize;
+    }
+
+    return size + sizeof(uint16_t);
+}
+
+
+/// <summary>Hash function for PIDLs, usable as the hash of unordered containers.</summary>
+/// <remarks>
+/// The hash is computed over the complete SHITEMID chain (8 bytes per step), equal PIDL bytes
+/// result in equal hashes. The hash is not stable across versions and should not be persisted.
+/// </remarks>
+struct PidlHash final
+{
+    [[nodiscard]] size_t operator()(const void* pidl) const noexcept
+    {
+        return static_cast<size_t>(Hash(pidl));
+    }
+
+    [[nodiscard]] static uint64_t Hash(const void* pidl) noexcept
+    {
+        return Hash(pidl, GetPidlSize(pidl));
+    }
+
+    // Purpose: hashes 'size' bytes, size must be the result of GetPidlSize.
+    [[nodiscard]] static uint64_t Hash(const void* pidl, size_t size) noexcept
+    {
+        const auto* bytes = static_cast<const std::byte*>(pidl);
+        uint64_t hash = Seed ^ (size * Multiplier);
+
+        size_t offset = 0;
+        for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+        {
+            uint64_t chunk;
+            std::memcpy(&chunk, bytes + offset, sizeof chunk);
+            hash = Mix(hash, chunk);
+        }
+
+        if (offset < size)
+        {
+            uint64_t chunk{};
+            std::memcpy(&chunk, bytes + offset, size - offset);
+            hash = Mix(hash, chunk);
+        }
+
+        // Final avalanche: makes the low bits usable as bucket index.
+        hash ^= hash >> 33;
+        hash *= Multiplier;
+        hash ^= hash >> 29;
+        return hash;
+    }
+
+private:
+    static constexpr uint64_t Seed = 0x9E3779B97F4A7C15;
+    static constexpr uint64_t Multiplier = 0xFF51AFD7ED558CCD;
+
+    [[nodiscard]] static uint64_t Mix(uint64_t hash, uint64_t chunk) noexcept
+    {
+        hash ^= chunk * Multiplier;
+        hash = (hash << 27) | (hash >> 37);
+        return (hash * 5) + 0x52DCE729;
+    }
+};
+
+
+// Purpose: equality of PIDLs on their bytes, the companion of PidlHash.
+struct PidlEqual final
+{
+    [[nodiscard]] bool operator()(const void* pidl1, const void* pidl2) const noexcept
+    {
+        const size_t size = GetPidlSize(pidl1);
+        return size == GetPidlSize(pidl2) && std::memcmp(pidl1, pidl2, size) == 0;
+    }
+};
+
+} // namespace msf
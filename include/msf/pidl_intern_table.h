@@ -0,0 +1,229 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library).
+
+#include "pidl_hash.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace msf
+{
+
+/// <summary>Thread safe table that maps PIDL bytes to a stable 32 bit handle.</summary>
+/// <remarks>
+/// Caches can use the handle as key instead of a cloned PIDL: equal PIDLs get the same handle.
+/// Every Intern and AddRef must be balanced by a Release, the entry is removed (and its handle
+/// can be reused) when the last reference is released.
+/// The table is split into shards (selected by the PidlHash) to reduce lock contention.
+/// </remarks>
+class PidlInternTable final
+{
+public:
+    using Handle = uint32_t;
+    static constexpr Handle InvalidHandle = 0;
+
+    // Purpose: the table shared by all users in the process (for example the change notify batchers of all folders).
+    [[nodiscard]] static PidlInternTable& GetProcessTable()
+    {
+        static PidlInternTable table;
+        return table;
+    }
+
+    PidlInternTable() = default;
+    ~PidlInternTable() = default;
+    PidlInternTable(const PidlInternTable&) = delete;
+    PidlInternTable(PidlInternTable&&) = delete;
+    PidlInternTable& operator=(const PidlInternTable&) = delete;
+    PidlInternTable& operator=(PidlInternTable&&) = delete;
+
+    // Purpose: returns the handle of the PIDL and adds a reference. The PIDL is copied when it is not in the table.
+    [[nodiscard]] Handle Intern(const void* pidl)
+    {
+        const size_t size = GetPidlSize(pidl);
+        const uint64_t hash = PidlHash::Hash(pidl, size);
+        const auto shardIndex = static_cast<uint32_t>(hash & (ShardCount - 1));
+        auto& shard = m_shards[shardIndex];
+
+        std::lock_guard lock(shard.mutex);
+
+        const auto [first, last] = shard.index.equal_range(hash);
+        for (auto it = first; it != last; ++it)
+        {
+            auto& entry = shard.entries[it->second];
+            if (entry.size == size && std::memcmp(entry.pidl.get(), pidl, size) == 0)
+            {
+                ++entry.refCount;
+                return MakeHandle(shardIndex, it->second);
+            }
+        }
+
+        auto copy = std::make_unique<std::byte[]>(size);
+        std::memcpy(copy.get(), pidl, size);
+
+        const uint32_t slot = AllocateSlot(shard);
+        try
+        {
+            shard.index.emplace(hash, slot);
+        }
+        catch (...)
+        {
+            shard.freeSlots.push_back(slot);
+            throw;
+        }
+
+        shard.entries[slot] = {std::move(copy), size, hash, 1};
+        return MakeHandle(shardIndex, slot);
+    }
+
+    void AddRef(Handle handle) noexcept
+    {
+        auto& shard = GetShard(handle);
+        std::lock_guard lock(shard.mutex);
+
+        auto& entry = GetEntry(shard, handle);
+        assert(entry.refCount != 0 && "handle already released");
+        ++entry.refCount;
+    }
+
+    void Release(Handle handle) noexcept
+    {
+        auto& shard = GetShard(handle);
+        std::lock_guard lock(shard.mutex);
+
+        auto& entry = GetEntry(shard, handle);
+        assert(entry.refCount != 0 && "handle already released");
+        if (--entry.refCount != 0)
+            return;
+
+        const uint32_t slot = GetSlot(handle);
+        const auto [first, last] = shard.index.equal_range(entry.hash);
+        for (auto it = first; it != last; ++it)
+        {
+            if (it->second == slot)
+            {
+                shard.index.erase(it);
+                break;
+            }
+        }
+
+        entry.pidl.reset();
+        shard.freeSlots.push_back(slot); // cannot throw, see AllocateSlot.
+    }
+
+    // Purpose: returns the interned copy of the PIDL, which stays valid as long as a reference is held.
+    [[nodiscard]] const void* GetPidl(Handle handle) const noexcept
+    {
+        const auto& shard = GetShard(handle);
+        std::lock_guard lock(shard.mutex);
+
+        return GetEntry(shard, handle).pidl.get();
+    }
+
+    // Purpose: returns the number of distinct PIDLs in the table.
+    [[nodiscard]] size_t GetCount() const noexcept
+    {
+        size_t count = 0;
+        for (const auto& shard : m_shards)
+        {
+            std::lock_guard lock(shard.mutex);
+            count += shard.entries.size() - shard.freeSlots.size();
+        }
+
+        return count;
+    }
+
+private:
+    static constexpr uint32_t ShardBits = 4;
+    static constexpr uint32_t ShardCount = 1U << ShardBits;
+    static constexpr size_t MaxSlotCount = (size_t{1} << (32 - ShardBits)) - 1;
+
+    struct Entry final
+    {
+        std::unique_ptr<std::byte[]> pidl;
+        size_t size;
+        uint64_t hash;
+        uint32_t refCount;
+    };
+
+    // Note: the padding (1 cache line) keeps the data of 2 shards out of the same cache line, which prevents
+    //       false sharing. An alignment specifier would do the same, but causes warning C4324.
+    struct Shard final
+    {
+        mutable std::mutex mutex;
+        std::vector<Entry> entries;
+        std::vector<uint32_t> freeSlots;
+        std::unordered_multimap<uint64_t, uint32_t> index;
+        std::byte padding[64]{};
+    };
+
+    // Note: slot + 1 is stored, which makes 0 an invalid handle.
+    [[nodiscard]] static Handle MakeHandle(uint32_t shardIndex, uint32_t slot) noexcept
+    {
+        return ((slot + 1) << ShardBits) | shardIndex;
+    }
+
+    [[nodiscard]] static uint32_t GetSlot(Handle handle) noexcept
+    {
+        return (handle >> ShardBits) - 1;
+    }
+
+    // Note: the capacity of the free list is kept at the number of entries, which makes releasing a slot no-throw.
+    [[nodiscard]] static uint32_t AllocateSlot(Shard& shard)
+    {
+        if (!shard.freeSlots.empty())
+        {
+            const uint32_t slot = shard.freeSlots.back();
+            shard.freeSlots.pop_back();
+            return slot;
+        }
+
+        if (shard.entries.size() >= MaxSlotCount)
+            throw std::length_error("PidlInternTable: too many PIDLs");
+
+        shard.freeSlots.reserve(shard.entries.size() + 1);
+        shard.entries.emplace_back();
+        return static_cast<uint32_t>(shard.entries.size() - 1);
+    }
+
+    [[nodiscard]] Shard& GetShard(Handle handle) noexcept
+    {
+        assert(handle != InvalidHandle);
+        return m_shards[handle & (ShardCount - 1)];
+    }
+
+    [[nodiscard]] const Shard& GetShard(Handle handle) const noexcept
+    {
+        assert(handle != InvalidHandle);
+        return m_shards[handle & (ShardCount - 1)];
+    }
+
+    [[nodiscard]] static Entry& GetEntry(Shard& shard, Handle handle) noexcept
+    {
+        assert(GetSlot(handle) < shard.entries.size() && "invalid handle");
+        return shard.entries[GetSlot(handle)];
+    }
+
+    [[nodiscard]] static const Entry& GetEntry(const Shard& shard, Handle handle) noexcept
+    {
+        assert(GetSlot(handle) < shard.entries.size() && "invalid handle");
+        return shard.entries[GetSlot(handle)];
+    }
+
+    std::array<Shard, ShardCount> m_shards;
+};
+
+} // namespace msf
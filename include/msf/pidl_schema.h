@@ -0,0 +1,268 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library),
+//       which makes it possible to test and measure the schema outside Windows.
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace msf
+{
+
+/// <summary>Compile-time description of the data layout of a SHITEMID.</summary>
+/// <remarks>
+/// Fixed size fields (trivially copyable types) are stored in declaration order without padding.
+/// For a std::wstring_view or std::string_view (binary data) field the fixed part contains the
+/// length (uint16_t, in characters), the zero terminated characters follow the fixed part in declaration order.
+/// The data of a SHITEMID has no alignment guarantee: fixed size fields are always read with memcpy.
+/// Bounds are only checked in debug builds; use IsValid to validate PIDLs from external sources.
+/// </remarks>
+template<typename... TFields>
+class PidlSchema final
+{
+public:
+    static_assert(sizeof...(TFields) > 0, "a schema needs at least one field");
+    static_assert(((std::is_same_v<TFields, std::wstring_view> || std::is_same_v<TFields, std::string_view> ||
+                    std::is_trivially_copyable_v<TFields>) && ...),
+                  "fields must be std::wstring_view, std::string_view or trivially copyable");
+
+    template<size_t Index>
+    using FieldType = std::tuple_element_t<Index, std::tuple<TFields...>>;
+
+    static constexpr size_t FieldCount = sizeof...(TFields);
+    static constexpr size_t MaxStringLength = UINT16_MAX - 1;
+
+    // Purpose: returns the size of the data of a SHITEMID that contains the passed values.
+    [[nodiscard]] static constexpr size_t GetSize(const TFields&... values) noexcept
+    {
+        return FixedPartSize + (GetStringSize(values) + ...);
+    }
+
+    // Purpose: writes the values into a buffer of at least GetSize(values...) bytes.
+    static void Write(void* buffer, const TFields&... values) noexcept
+    {
+        WriteFields(static_cast<std::byte*>(buffer), std::index_sequence_for<TFields...>(), values...);
+    }
+
+    // Purpose: checks that data of 'size' bytes contains the fixed part and all zero terminated strings.
+    [[nodiscard]] static bool IsValid(const void* data, size_t size) noexcept
+    {
+        if (size < FixedPartSize)
+            return false;
+
+        const auto* bytes = static_cast<const std::byte*>(data);
+        size_t stringOffset = FixedPartSize;
+        for (size_t i = 0; i < StringCount; ++i)
+        {
+            const size_t charSize = StringCharSizes[i];
+            const size_t stringSize = (size_t{ReadLength(bytes + StringLengthOffsets[i])} + 1) * charSize;
+            if (size < stringOffset + stringSize)
+                return false;
+
+            for (size_t j = stringOffset + stringSize - charSize; j < stringOffset + stringSize; ++j)
+            {
+                if (bytes[j] != std::byte{})
+                    return false; // terminator missing.
+            }
+
+            stringOffset += stringSize;
+        }
+
+        return true;
+    }
+
+    /// <summary>Zero-copy, typed access to the data of a SHITEMID.</summary>
+    class View final
+    {
+    public:
+        View(const void* data, [[maybe_unused]] size_t size) noexcept :
+            m_data{static_cast<const std::byte*>(data)}
+#ifndef NDEBUG
+            , m_size{size}
+#endif
+        {
+        }
+
+        template<size_t Index>
+        [[nodiscard]] FieldType<Index> Get() const noexcept
+        {
+            if constexpr (IsString<FieldType<Index>>)
+            {
+                using TChar = typename FieldType<Index>::value_type;
+
+                size_t stringOffset = FixedPartSize;
+                for (size_t i = 0; i < StringIndex<Index>; ++i)
+                {
+                    stringOffset += (size_t{ReadLength(m_data + StringLengthOffsets[i])} + 1) * StringCharSizes[i];
+                }
+
+                const size_t length = ReadLength(m_data + Offsets[Index]);
+                assert(stringOffset + ((length + 1) * sizeof(TChar)) <= m_size && "string outside SHITEMID");
+                return {reinterpret_cast<const TChar*>(m_data + stringOffset), length};
+            }
+            else
+            {
+                assert(Offsets[Index] + sizeof(FieldType<Index>) <= m_size && "field outside SHITEMID");
+                FieldType<Index> value;
+                std::memcpy(&value, m_data + Offsets[Index], sizeof value);
+                return value;
+            }
+        }
+
+    private:
+        const std::byte* m_data;
+#ifndef NDEBUG
+        size_t m_size;
+#endif
+    };
+
+private:
+    template<typename T>
+    static constexpr bool IsString = std::is_same_v<T, std::wstring_view> || std::is_same_v<T, std::string_view>;
+
+    template<typename T>
+    static constexpr size_t CharSize() noexcept
+    {
+        if constexpr (IsString<T>)
+        {
+            return sizeof(typename T::value_type);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    template<typename T>
+    static constexpr size_t FixedFieldSize = IsString<T> ? sizeof(uint16_t) : sizeof(T);
+
+    static constexpr std::array<size_t, FieldCount> ComputeOffsets() noexcept
+    {
+        constexpr size_t sizes[]{FixedFieldSize<TFields>...};
+        std::array<size_t, FieldCount> offsets{};
+        size_t offset = 0;
+        for (size_t i = 0; i < FieldCount; ++i)
+        {
+            offsets[i] = offset;
+            offset += sizes[i];
+        }
+
+        return offsets;
+    }
+
+    static constexpr std::array<size_t, FieldCount> Offsets = ComputeOffsets();
+    static constexpr size_t FixedPartSize = (FixedFieldSize<TFields> + ...);
+    static constexpr size_t StringCount = (size_t{IsString<TFields>} + ...);
+
+    static constexpr std::array<size_t, StringCount> ComputeStringLengthOffsets() noexcept
+    {
+        constexpr bool isString[]{IsString<TFields>...};
+        std::array<size_t, StringCount> lengthOffsets{};
+        size_t stringIndex = 0;
+        for (size_t i = 0; i < FieldCount; ++i)
+        {
+            if (isString[i])
+            {
+                lengthOffsets[stringIndex] = Offsets[i];
+                ++stringIndex;
+            }
+        }
+
+        return lengthOffsets;
+    }
+
+    static constexpr std::array<size_t, StringCount> StringLengthOffsets = ComputeStringLengthOffsets();
+
+    static constexpr std::array<size_t, StringCount> ComputeStringCharSizes() noexcept
+    {
+        constexpr size_t charSizes[]{CharSize<TFields>()...};
+        std::array<size_t, StringCount> stringCharSizes{};
+        size_t stringIndex = 0;
+        for (size_t i = 0; i < FieldCount; ++i)
+        {
+            if (charSizes[i] != 0)
+            {
+                stringCharSizes[stringIndex] = charSizes[i];
+                ++stringIndex;
+            }
+        }
+
+        return stringCharSizes;
+    }
+
+    static constexpr std::array<size_t, StringCount> StringCharSizes = ComputeStringCharSizes();
+
+    // Purpose: the number of strings that are stored before the field with the passed index.
+    template<size_t Index>
+    static constexpr size_t StringIndex = []() noexcept {
+        constexpr bool isString[]{IsString<TFields>...};
+        size_t count = 0;
+        for (size_t i = 0; i < Index; ++i)
+        {
+            count += isString[i] ? 1 : 0;
+        }
+
+        return count;
+    }();
+
+    template<typename T>
+    static constexpr size_t GetStringSize(const T& value) noexcept
+    {
+        if constexpr (IsString<T>)
+        {
+            return (value.size() + 1) * CharSize<T>();
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    static uint16_t ReadLength(const std::byte* p) noexcept
+    {
+        uint16_t length;
+        std::memcpy(&length, p, sizeof length);
+        return length;
+    }
+
+    template<size_t... Indices>
+    static void WriteFields(std::byte* buffer, std::index_sequence<Indices...>, const TFields&... values) noexcept
+    {
+        size_t stringOffset = FixedPartSize;
+        (WriteField<Indices>(buffer, stringOffset, values), ...);
+    }
+
+    template<size_t Index, typename T>
+    static void WriteField(std::byte* buffer, size_t& stringOffset, const T& value) noexcept
+    {
+        if constexpr (IsString<T>)
+        {
+            assert(value.size() <= MaxStringLength && "string too long for a SHITEMID");
+            const auto length = static_cast<uint16_t>(value.size());
+            std::memcpy(buffer + Offsets[Index], &length, sizeof length);
+
+            std::memcpy(buffer + stringOffset, value.data(), value.size() * CharSize<T>());
+            constexpr typename T::value_type terminator{};
+            std::memcpy(buffer + stringOffset + (value.size() * CharSize<T>()), &terminator, sizeof terminator);
+            stringOffset += (value.size() + 1) * CharSize<T>();
+        }
+        else
+        {
+            std::memcpy(buffer + Offsets[Index], &value, sizeof value);
+        }
+    }
+};
+
+} // namespace msf
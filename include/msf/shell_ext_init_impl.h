@@ -54,11 +54,9 @@ class IShellExtInitImpl : public IShellExtInit
         ClipboardFormatHDrop cfhdrop(pDataObject);
 
         m_filenames.clear();
-
-        const auto uFiles = cfhdrop.GetFileCount();
-        for (unsigned int i = 0; i < uFiles; ++i)
+        m_filenames.reserve(cfhdrop.GetFileCount());
+        for (const auto filename : cfhdrop.GetFiles())
         {
-            const auto filename = cfhdrop.GetFile(i);
             m_filenames.emplace_back(filename);
         }
     }
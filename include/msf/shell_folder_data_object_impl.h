@@ -7,6 +7,8 @@
 
 
 #include "cf_handler.h"
+#include "cf_shell_id_list_handler.h"
+#include "clipboard_format_handler_map.h"
 #include "enum_format_etc.h"
 #include "format_etc.h"
 #include "cf_performed_drop_effect_handler.h"
@@ -15,6 +17,8 @@
 
 #include <memory>
 #include <algorithm>
+#include <tuple>
+#include <vector>
 
 namespace msf
 {
@@ -35,7 +39,7 @@ class ShellFolderDataObjectImpl : public IDataObject
 
         try
         {
-            const ClipboardFormatHandler* pcfhandler = FindClipFormatHandler(pformatetc->cfFormat);
+            const ClipboardFormatHandler* pcfhandler = m_cfhandlers.Find(pformatetc->cfFormat);
             if (pcfhandler)
             {
                 if (pcfhandler->CanGetData())
@@ -47,6 +51,9 @@ class ShellFolderDataObjectImpl : public IDataObject
             }
             else
             {
+                if (IsAbsentPidlDataFormat(*pformatetc))
+                    return DV_E_FORMATETC;
+
                 const auto hr = m_pidldata->GetData(pformatetc, pstgmedium);
                 if (FAILED(hr))
                 {
@@ -86,7 +93,7 @@ class ShellFolderDataObjectImpl : public IDataObject
 
         try
         {
-            const ClipboardFormatHandler* pcfhandler = FindClipFormatHandler(pformatetc->cfFormat);
+            const ClipboardFormatHandler* pcfhandler = m_cfhandlers.Find(pformatetc->cfFormat);
             if (pcfhandler)
             {
                 if (pcfhandler->CanGetData())
@@ -96,7 +103,16 @@ class ShellFolderDataObjectImpl : public IDataObject
                 return DV_E_FORMATETC;
             }
 
-            return m_pidldata->QueryGetData(pformatetc);
+            if (IsAbsentPidlDataFormat(*pformatetc))
+                return DV_E_FORMATETC;
+
+            const HRESULT result = m_pidldata->QueryGetData(pformatetc);
+            if (result == DV_E_FORMATETC)
+            {
+                AddAbsentPidlDataFormat(*pformatetc);
+            }
+
+            return result;
         }
         catch (...)
         {
@@ -124,7 +140,7 @@ class ShellFolderDataObjectImpl : public IDataObject
             if (pformatetc->tymed != pstgmedium->tymed)
                 return DV_E_TYMED;
 
-            auto pcfhandler = FindClipFormatHandler(pformatetc->cfFormat);
+            auto pcfhandler = m_cfhandlers.Find(pformatetc->cfFormat);
             if (pcfhandler)
             {
                 if (pcfhandler->CanSetData())
@@ -137,6 +153,9 @@ class ShellFolderDataObjectImpl : public IDataObject
                 return E_FAIL;
             }
 
+            // The inner data object may provide new formats after SetData.
+            m_absentPidlDataFormats.clear();
+            InvalidateFormatEtcs();
             return m_pidldata->SetData(pformatetc, pstgmedium, fRelease);
         }
         catch (...)
@@ -154,11 +173,14 @@ class ShellFolderDataObjectImpl : public IDataObject
             if (dwDirection != DATADIR_GET && dwDirection != DATADIR_SET)
                 return E_INVALIDARG;
 
-            std::vector<FormatEtc> formatEtcs;
-            GetRegisteredFormats(dwDirection, formatEtcs);
-            GetPidlDataFormats(dwDirection, formatEtcs);
+            // The merged list is created once, all enumerators share it.
+            auto& formatEtcs = dwDirection == DATADIR_GET ? m_getFormatEtcs : m_setFormatEtcs;
+            if (!formatEtcs)
+            {
+                formatEtcs = CreateFormatEtcs(dwDirection);
+            }
 
-            *ppenumFormatEtc = SHCreateStdEnumFmtEtc(static_cast<uint32_t>(formatEtcs.size()), formatEtcs.data()).Detach();
+            *ppenumFormatEtc = EnumFORMATETC::CreateInstance(formatEtcs).Detach();
 
             return S_OK;
         }
@@ -205,26 +227,72 @@ class ShellFolderDataObjectImpl : public IDataObject
     {
         m_pidldata = static_cast<IDataObject*>(CIDLData_CreateFromIDArray(pidlFolder, cidl, reinterpret_cast<PCUIDLIST_RELATIVE_ARRAY>(ppidl)));
         RegisterClipboardFormatHandler(std::make_unique<ClipboardPerformedDropEffectHandler>(pperformeddropeffectsink, this));
+
+        // Note: CFSTR_SHELLIDLIST is served from the CIDA that the handler builds once, in 1 pass.
+        RegisterClipboardFormatHandler(std::make_unique<CCfShellIdListHandler>(pidlFolder, ppidl, cidl));
     }
 
     void RegisterClipboardFormatHandler(std::unique_ptr<ClipboardFormatHandler> qcfhandler)
     {
-        ATLASSERT(!FindClipFormatHandler(qcfhandler->GetClipFormat()) && "Cannot register a ClipBoard handler twice!");
-        m_cfhandlers.push_back(std::move(qcfhandler));
+        m_cfhandlers.Register(std::move(qcfhandler));
+        InvalidateFormatEtcs();
     }
 
 private:
-    [[nodiscard]] ClipboardFormatHandler* FindClipFormatHandler(CLIPFORMAT clipFormat) const noexcept
+    // Purpose: identifies a rejected probe. The inner data object can reject a format for 1 medium,
+    //          aspect or index and accept it for another, the complete request is the key.
+    struct AbsentFormat final
     {
-        auto handler = std::find_if(m_cfhandlers.begin(), m_cfhandlers.end(),
-            [=](const std::unique_ptr<ClipboardFormatHandler>& clipFormatHandler) noexcept
+        CLIPFORMAT cfFormat;
+        DWORD tymed;
+        DWORD dwAspect;
+        LONG lindex;
+
+        explicit AbsentFormat(const FORMATETC& formatetc) noexcept :
+            cfFormat{formatetc.cfFormat}, tymed{formatetc.tymed}, dwAspect{formatetc.dwAspect}, lindex{formatetc.lindex}
         {
-            return clipFormatHandler->GetClipFormat() == clipFormat;
-        });
-        return handler == m_cfhandlers.end() ? nullptr : (*handler).get();
+        }
+
+        bool operator<(const AbsentFormat& other) const noexcept
+        {
+            return std::tie(cfFormat, tymed, dwAspect, lindex) < std::tie(other.cfFormat, other.tymed, other.dwAspect, other.lindex);
+        }
+    };
+
+    // Purpose: Explorer probes many formats during drag-over and paste enablement, formats that the
+    //          inner data object doesn't provide are remembered (sorted, binary search) to answer the next probe directly.
+    //          Probes for a target device are not cached (rare, and the device is not part of the key).
+    [[nodiscard]] bool IsAbsentPidlDataFormat(const FORMATETC& formatetc) const noexcept
+    {
+        return !formatetc.ptd &&
+               std::binary_search(m_absentPidlDataFormats.begin(), m_absentPidlDataFormats.end(), AbsentFormat(formatetc));
     }
 
-    void GetRegisteredFormats(DWORD direction, std::vector<FormatEtc>& formatEtcs) const
+    void AddAbsentPidlDataFormat(const FORMATETC& formatetc)
+    {
+        if (formatetc.ptd)
+            return;
+
+        const AbsentFormat absentFormat(formatetc);
+        m_absentPidlDataFormats.insert(
+            std::lower_bound(m_absentPidlDataFormats.begin(), m_absentPidlDataFormats.end(), absentFormat), absentFormat);
+    }
+
+    [[nodiscard]] std::shared_ptr<EnumFORMATETC::FormatEtcs> CreateFormatEtcs(DWORD direction)
+    {
+        auto formatEtcs = std::make_shared<EnumFORMATETC::FormatEtcs>();
+        GetRegisteredFormats(direction, *formatEtcs);
+        GetPidlDataFormats(direction, *formatEtcs);
+        return formatEtcs;
+    }
+
+    void InvalidateFormatEtcs() noexcept
+    {
+        m_getFormatEtcs.reset();
+        m_setFormatEtcs.reset();
+    }
+
+    void GetRegisteredFormats(DWORD direction, EnumFORMATETC::FormatEtcs& formatEtcs) const
     {
         for (const auto& handler : m_cfhandlers)
         {
@@ -232,33 +300,43 @@ class ShellFolderDataObjectImpl : public IDataObject
             {
                 if (handler->CanGetData())
                 {
-                    formatEtcs.push_back(FormatEtc(handler->GetClipFormat()));
+                    formatEtcs.push_back(FormatEtc(handler->GetClipFormat(), handler->GetTymed()));
                 }
             }
             else
             {
                 if (handler->CanSetData())
                 {
-                    formatEtcs.push_back(FormatEtc(handler->GetClipFormat()));
+                    formatEtcs.push_back(FormatEtc(handler->GetClipFormat(), handler->GetTymed()));
                 }
             }
         }
     }
 
-    void GetPidlDataFormats(DWORD dwDirection, std::vector<FormatEtc>& formatEtcs)
+    // Note: the snapshot doesn't own target devices, formats of the inner data object are stored without one (shell formats are device independent).
+    //       Formats of registered handlers are skipped: the handler serves them (for example CFSTR_SHELLIDLIST), they are listed once.
+    void GetPidlDataFormats(DWORD dwDirection, EnumFORMATETC::FormatEtcs& formatEtcs)
     {
         IEnumFORMATETCPtr enumFormatEtc = m_pidldata.EnumFormatEtc(dwDirection);
 
         FormatEtc formatEtc;
         while (enumFormatEtc.Next(formatEtc))
         {
-            formatEtcs.push_back(formatEtc);
+            if (m_cfhandlers.Find(formatEtc.cfFormat))
+                continue;
+
+            FORMATETC value = formatEtc;
+            value.ptd = nullptr;
+            formatEtcs.push_back(value);
         }
     }
 
     // Member variables.
     IDataObjectPtr m_pidldata;
-    std::vector<std::unique_ptr<ClipboardFormatHandler>> m_cfhandlers;
+    ClipboardFormatHandlerMap m_cfhandlers;
+    std::vector<AbsentFormat> m_absentPidlDataFormats;
+    std::shared_ptr<EnumFORMATETC::FormatEtcs> m_getFormatEtcs;
+    std::shared_ptr<EnumFORMATETC::FormatEtcs> m_setFormatEtcs;
 };
 
 } // end msf namespace
@@ -7,12 +7,15 @@
 
 #include "msf_base.h"
 #include "pidl.h"
+#include "pidl_compare.h"
+#include "sort_key.h"
 #include "update_registry.h"
 // ReSharper disable once CppUnusedIncludeDirective
 #include "cf_paste_succeeded.h"
 #include "cf_performed_drop_effect.h"
 #include "cf_preferred_drop_effect.h"
 #include "cf_shell_id_list.h"
+#include "change_notify_batcher.h"
 #include "dfm_defines.h"
 #include "extract_icon.h"
 #include "idldatacreatefromidarray.h"
@@ -22,6 +25,14 @@
 #include "query_info.h"
 #include "shell_folder_context_menu.h"
 #include "smartptr/shellbrowserptr.h"
+#include "static_enum_id_list.h"
+
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <memory>
+#include <mutex>
+#include <optional>
 
 namespace msf
 {
@@ -237,7 +248,7 @@ class __declspec(novtable) ShellFolderImpl :
 
             static_cast<IUnknown*>(*ppRetVal)->Release();
 
-            ItemIDList bindFolder(GetRootFolder(), subFolder);
+            TransientItemIDList bindFolder(GetRootFolder(), subFolder);
 
             // Get all sub folder items.
             std::vector<TItem> items;
@@ -282,15 +293,29 @@ class __declspec(novtable) ShellFolderImpl :
             int nResult = 0;
             while (pidl1 != nullptr && pidl2 != nullptr)
             {
-                TItem item1(pidl1);
-                TItem item2(pidl2);
-
-                ATLTRACE(L"ShellFolderImpl::IShellFolder::CompareIDs (lparam=%X, name1=%s, name2=%s)\n",
-                         lParam, item1.GetDisplayName(SHGDN_NORMAL).c_str(), item2.GetDisplayName(SHGDN_NORMAL).c_str());
-
-                nResult = static_cast<T*>(this)->CompareItems(lParam, item1, item2);
-                if (nResult != 0)
-                    break; // different items.
+                // Note: levels that are byte-wise equal are equal, there is no need to create items.
+                //       Common for deep hierarchies, which often share the same parent levels.
+                if (!AreItemIdsBinaryEqual(&pidl1->mkid, &pidl2->mkid))
+                {
+                    if constexpr (HasCanonicalBinaryIdentityV<TItem>)
+                    {
+                        if (IsBitSet(static_cast<ULONG>(lParam), SHCIDS_CANONICALONLY))
+                        {
+                            nResult = CompareItemIdsBinary(&pidl1->mkid, &pidl2->mkid);
+                            break; // different items.
+                        }
+                    }
+
+                    TItem item1(pidl1);
+                    TItem item2(pidl2);
+
+                    ATLTRACE(L"ShellFolderImpl::IShellFolder::CompareIDs (lparam=%X, name1=%s, name2=%s)\n",
+                             lParam, item1.GetDisplayName(SHGDN_NORMAL).c_str(), item2.GetDisplayName(SHGDN_NORMAL).c_str());
+
+                    nResult = static_cast<T*>(this)->CompareItems(lParam, item1, item2);
+                    if (nResult != 0)
+                        break; // different items.
+                }
 
                 pidl1 = ItemIDList::GetNextItem(pidl1);
                 pidl2 = ItemIDList::GetNextItem(pidl2);
@@ -525,9 +550,10 @@ class __declspec(novtable) ShellFolderImpl :
             }
 
             ItemIDList pidlNewItem(static_cast<T*>(this)->OnSetNameOf(hwndOwner, TItem(childItem), pszNewName, flags));
+            static_cast<const T*>(this)->OnItemsChanged();
 
             ChangeNotifyPidl(SHCNE_RENAMEITEM, 0,
-                             ItemIDList(m_pidlFolder, static_cast<PCUIDLIST_RELATIVE>(childItem)), ItemIDList(m_pidlFolder, pidlNewItem));
+                             TransientItemIDList(m_pidlFolder, static_cast<PCUIDLIST_RELATIVE>(childItem)), TransientItemIDList(m_pidlFolder, pidlNewItem));
 
             if (ppidlOut)
             {
@@ -554,7 +580,13 @@ class __declspec(novtable) ShellFolderImpl :
             if (ppRetVal == nullptr)
                 return E_POINTER;
 
-            *ppRetVal = static_cast<T*>(this)->CreateEnumIDList(window, grfFlags).Detach();
+            auto enumIdList = static_cast<T*>(this)->CreateEnumIDList(window, grfFlags);
+            if (const auto column = static_cast<const T*>(this)->GetEnumObjectsSortColumn())
+            {
+                enumIdList = CreateSortedEnumIDList(enumIdList, *column);
+            }
+
+            *ppRetVal = enumIdList.Detach();
             return S_OK;
         }
         catch (...)
@@ -816,8 +848,47 @@ class __declspec(novtable) ShellFolderImpl :
             return static_cast<const T*>(this)->CompareIDsAllFields(item1, item2);
         }
 
-        return item1.Compare(item2,
-                             static_cast<USHORT>(lParam), IsBitSet(static_cast<ULONG>(lParam), SHCIDS_CANONICALONLY));
+        return CompareColumn(item1, item2, static_cast<USHORT>(lParam), IsBitSet(static_cast<ULONG>(lParam), SHCIDS_CANONICALONLY));
+    }
+
+    // Purpose: sorts child items on a column. The sort key of every item is extracted once:
+    //          integer keys are sorted with a radix sort, binary keys with a parallel merge sort.
+    //          Items without sort keys (see HasSortKey and HasIntegerSortKey) are sorted with CompareItems.
+    void SortItems(PCUITEMID_CHILD* items, size_t count, uint32_t column, SORTDIRECTION direction = SORT_ASCENDING) const
+    {
+        if (count < 2)
+            return;
+
+        if constexpr (HasIntegerSortKeyV<TItem>)
+        {
+            if (SortItemsOnIntegerKey(items, count, column, direction))
+                return;
+        }
+
+        if constexpr (HasSortKeyV<TItem>)
+        {
+            if (SortItemsOnSortKey(items, count, column, direction))
+                return;
+        }
+
+        std::vector<TItem> sortItems;
+        sortItems.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            sortItems.emplace_back(items[i]);
+        }
+
+        // Note: CompareItems can be overridden and is not required to be thread safe: sort sequential.
+        const auto lParam = static_cast<LPARAM>(column);
+        std::stable_sort(sortItems.begin(), sortItems.end(), [this, lParam, direction](const TItem& item1, const TItem& item2) noexcept {
+            const int result = static_cast<const T*>(this)->CompareItems(lParam, item1, item2);
+            return direction == SORT_DESCENDING ? result > 0 : result < 0;
+        });
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            items[i] = static_cast<PCUITEMID_CHILD>(sortItems[i].GetItemIdList());
+        }
     }
 
     std::wstring GetPathJunctionPoint() const
@@ -874,7 +945,7 @@ class __declspec(novtable) ShellFolderImpl :
 
         for (size_t i = 0; i < m_columnInfos.size(); ++i)
         {
-            nResult = item1.Compare(item2, static_cast<USHORT>(i), false);
+            nResult = CompareColumn(item1, item2, static_cast<uint32_t>(i), false);
             if (nResult != 0)
                 break; // final result determined.
         }
@@ -882,6 +953,26 @@ class __declspec(novtable) ShellFolderImpl :
         return nResult;
     }
 
+    // Purpose: called when items of the folder were changed (add, rename, delete, change notifications).
+    //          Override this function to drop cached content of the folder.
+    void OnItemsChanged() const
+    {
+    }
+
+    // Purpose: the number of item change notifications of 1 operation that are sent individually.
+    //          Override this function to change the limit, more changes are reported as 1 SHCNE_UPDATEDIR of the folder.
+    size_t GetChangeNotifyCollapseThreshold() const noexcept
+    {
+        return ChangeNotifyBatcher<>::DefaultCollapseThreshold;
+    }
+
+    // Purpose: Called by MSF when the shell enumerates the folder.
+    //          Override this function and return a column to let EnumObjects return the items sorted on that column.
+    std::optional<uint32_t> GetEnumObjectsSortColumn() const noexcept
+    {
+        return std::nullopt;
+    }
+
     // Purpose: Called by shell/MSF.
     //          It is essential to override this function to control which explorer panes are visible.
     //          The default implementation will just return 'ignore', which will result in almost not visible.
@@ -1120,16 +1211,25 @@ class __declspec(novtable) ShellFolderImpl :
 
                 const long eventId = static_cast<T*>(this)->OnProperties(window, items);
 
-                if (IsBitSet(eventId, SHCNE_RENAMEITEM))
+                if (IsBitSet(eventId, SHCNE_RENAMEITEM) || IsBitSet(eventId, SHCNE_ATTRIBUTES))
                 {
-                    ATLTRACE(L"ShellFolderImpl::OnDfmCmdProperties (firing SHCNE_RENAMEITEM)\n");
-                    ReportRenameChangeNotify(shellItemIds, items);
-                }
-
-                if (IsBitSet(eventId, SHCNE_ATTRIBUTES))
-                {
-                    ATLTRACE(L"ShellFolderImpl::OnDfmCmdProperties (firing SHCNE_ATTRIBUTES)\n");
-                    ReportChangeNotify(items, SHCNE_ATTRIBUTES);
+                    // 1 invalidation and 1 batch for both kinds of changes.
+                    static_cast<const T*>(this)->OnItemsChanged();
+                    auto batcher = CreateChangeNotifyBatcher();
+
+                    if (IsBitSet(eventId, SHCNE_RENAMEITEM))
+                    {
+                        ATLTRACE(L"ShellFolderImpl::OnDfmCmdProperties (firing SHCNE_RENAMEITEM)\n");
+                        AddRenameChangeNotify(batcher, shellItemIds, items);
+                    }
+
+                    if (IsBitSet(eventId, SHCNE_ATTRIBUTES))
+                    {
+                        ATLTRACE(L"ShellFolderImpl::OnDfmCmdProperties (firing SHCNE_ATTRIBUTES)\n");
+                        AddChangeNotify(batcher, items, SHCNE_ATTRIBUTES);
+                    }
+
+                    batcher.Flush();
                 }
             }
 
@@ -1159,11 +1259,14 @@ class __declspec(novtable) ShellFolderImpl :
             VerifyAttribute(shellItemIds, SFGAO_CANDELETE);
 
             const long wEventId = static_cast<T*>(this)->OnDelete(window, items);
+            static_cast<const T*>(this)->OnItemsChanged(); // also when no notification is requested.
 
             if (IsBitSet(wEventId, SHCNE_DELETE))
             {
                 ATLTRACE(L"ShellFolderImpl::OnDeleteFromDataObject (firing SHCNE_DELETEs)\n");
-                ReportChangeNotify(shellItemIds, SHCNE_DELETE);
+                auto batcher = CreateChangeNotifyBatcher();
+                AddChangeNotify(batcher, shellItemIds, SHCNE_DELETE);
+                batcher.Flush();
             }
 
             if (IsBitSet(wEventId, SHCNE_UPDATEDIR))
@@ -1467,48 +1570,86 @@ class __declspec(novtable) ShellFolderImpl :
 
     void ReportAddItem(PCUIDLIST_RELATIVE item) const
     {
-        ChangeNotifyPidl(SHCNE_CREATE, SHCNF_FLUSH, ItemIDList(m_pidlFolder, item));
+        ReportAddItems({item});
     }
 
-    void ReportChangeNotify(const std::vector<TItem>& items, long eventId, uint32_t flags = SHCNF_FLUSH) const
+    // Purpose: reports the items added by 1 operation (a drop), the notifications are batched.
+    void ReportAddItems(const std::vector<PCUIDLIST_RELATIVE>& items) const
     {
-        for (auto item : items)
+        static_cast<const T*>(this)->OnItemsChanged();
+        auto batcher = CreateChangeNotifyBatcher();
+        for (const auto item : items)
         {
-            ChangeNotifyPidl(eventId, flags, ItemIDList(m_pidlFolder, item.GetItemIdList()));
+            batcher.Add(SHCNE_CREATE, item);
         }
+
+        batcher.Flush();
     }
 
-    void ReportChangeNotify(const CfShellIdList& items, long eventId, uint32_t flags = SHCNF_FLUSH) const
+    void ReportChangeNotify(const std::vector<TItem>& items, long eventId) const
     {
-        for (size_t i = 0; i < items.size(); ++i)
-        {
-            const PCUIDLIST_RELATIVE childItem = items.GetItem(i);
+        ReportChangeNotify(items, eventId, SHCNF_FLUSHNOWAIT);
+    }
 
-            ChangeNotifyPidl(eventId, flags, ItemIDList(m_pidlFolder.GetAbsolute(), childItem));
-        }
+    // Purpose: as the overload without flags, the flush flags (SHCNF_FLUSH or SHCNF_FLUSHNOWAIT) are used for the last event.
+    //          Use SHCNF_FLUSH to wait until the shell has processed the events.
+    void ReportChangeNotify(const std::vector<TItem>& items, long eventId, uint32_t flags) const
+    {
+        static_cast<const T*>(this)->OnItemsChanged();
+        auto batcher = CreateChangeNotifyBatcher();
+        AddChangeNotify(batcher, items, eventId);
+        batcher.Flush(flags);
     }
 
-    void ReportUpdateItemChangeNotify(IDataObject* dataObject) const
+    void ReportChangeNotify(const CfShellIdList& items, long eventId) const
     {
-        const CfShellIdList items(dataObject);
+        ReportChangeNotify(items, eventId, SHCNF_FLUSHNOWAIT);
+    }
 
-        for (size_t i = 0; i < items.size(); ++i)
-        {
-            const PCUIDLIST_RELATIVE childItem = items.GetItem(i);
+    void ReportChangeNotify(const CfShellIdList& items, long eventId, uint32_t flags) const
+    {
+        static_cast<const T*>(this)->OnItemsChanged();
+        auto batcher = CreateChangeNotifyBatcher();
+        AddChangeNotify(batcher, items, eventId);
+        batcher.Flush(flags);
+    }
 
-            ChangeNotifyPidl(SHCNE_ATTRIBUTES, SHCNF_FLUSH, ItemIDList{m_pidlFolder, childItem});
-        }
+    void ReportUpdateItemChangeNotify(IDataObject* dataObject) const
+    {
+        ReportChangeNotify(CfShellIdList(dataObject), SHCNE_ATTRIBUTES);
     }
 
     void ReportRenameChangeNotify(const CfShellIdList& items, const std::vector<TItem>& itemsNew) const
     {
-        for (size_t i = 0; i < items.size(); ++i)
-        {
-            const PCUIDLIST_RELATIVE pidlOld = items.GetItem(i);
+        static_cast<const T*>(this)->OnItemsChanged();
+        auto batcher = CreateChangeNotifyBatcher();
+        AddRenameChangeNotify(batcher, items, itemsNew);
+        batcher.Flush();
+    }
 
-            ChangeNotifyPidl(SHCNE_RENAMEITEM, SHCNF_FLUSH,
-                             ItemIDList(m_pidlFolder, pidlOld), ItemIDList(m_pidlFolder, itemsNew[i].GetItemIdList()));
-        }
+    [[nodiscard]] ChangeNotifyBatcher<> CreateChangeNotifyBatcher() const
+    {
+        return ChangeNotifyBatcher<>(m_pidlFolder.GetAbsolute(), static_cast<const T*>(this)->GetChangeNotifyCollapseThreshold());
+    }
+
+    // Purpose: remembers the cancellation flag of the view callback (see ShellFolderViewCBImpl::GetEnumCancellation).
+    //          Call this function in CreateShellFolderViewCB.
+    void SetEnumCancellation(std::shared_ptr<const std::atomic<bool>> cancelled)
+    {
+        std::lock_guard lock(m_enumCancellationMutex);
+        m_enumCancelled = std::move(cancelled);
+    }
+
+    // Purpose: returns the flag of the view, pass it to the enumerator of CreateEnumIDList (IEnumIDListImpl::SetCancellation).
+    //          EnumObjects can be called on a background thread. A flag that is already set (the view was closed) is not
+    //          returned: an enumeration that starts after the view was closed is not for that view.
+    [[nodiscard]] std::shared_ptr<const std::atomic<bool>> GetEnumCancellation() const
+    {
+        std::lock_guard lock(m_enumCancellationMutex);
+        if (m_enumCancelled && m_enumCancelled->load())
+            return nullptr;
+
+        return m_enumCancelled;
     }
 
     // Note: if hwndOwner is NULL, errors should only be returned as COM failures.
@@ -1553,6 +1694,31 @@ class __declspec(novtable) ShellFolderImpl :
         return OnErrorHandler(result, window, errorContext);
     }
 
+    // Purpose: the Add functions only collect the events, the caller calls OnItemsChanged once per operation.
+    static void AddChangeNotify(ChangeNotifyBatcher<>& batcher, const std::vector<TItem>& items, long eventId)
+    {
+        for (const auto& item : items)
+        {
+            batcher.Add(eventId, item.GetItemIdList());
+        }
+    }
+
+    static void AddChangeNotify(ChangeNotifyBatcher<>& batcher, const CfShellIdList& items, long eventId)
+    {
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            batcher.Add(eventId, items.GetItem(i));
+        }
+    }
+
+    static void AddRenameChangeNotify(ChangeNotifyBatcher<>& batcher, const CfShellIdList& items, const std::vector<TItem>& itemsNew)
+    {
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            batcher.Add(SHCNE_RENAMEITEM, items.GetItem(i), itemsNew[i].GetItemIdList());
+        }
+    }
+
     static ATL::CString GetExplorerPaneName(_In_ REFEXPLORERPANE explorerPane)
     {
         if (explorerPane == __uuidof(EP_NavPane))
@@ -1572,11 +1738,123 @@ class __declspec(novtable) ShellFolderImpl :
         return ATL::CString(epId);
     }
 
+    // Purpose: compares 2 items on 1 column. Precomputed keys are used when the item type provides them.
+    //          Keys only order items: equal keys are resolved by TItem::Compare, which decides equality.
+    int CompareColumn(const TItem& item1, const TItem& item2, uint32_t column, bool canonicalOnly) const noexcept
+    {
+        if constexpr (HasSortKeyV<TItem>)
+        {
+            const auto key1 = item1.GetSortKey(column);
+            const auto key2 = item2.GetSortKey(column);
+            if (!key1.empty() && !key2.empty())
+            {
+                const int result = CompareSortKeys(key1, key2);
+                if (result != 0)
+                    return result;
+            }
+        }
+
+        if constexpr (HasIntegerSortKeyV<TItem>)
+        {
+            const auto key1 = item1.GetIntegerSortKey(column);
+            const auto key2 = item2.GetIntegerSortKey(column);
+            if (key1 && key2 && *key1 != *key2)
+                return *key1 > *key2 ? 1 : -1;
+        }
+
+        return item1.Compare(item2, static_cast<USHORT>(column), canonicalOnly);
+    }
+
+    bool SortItemsOnIntegerKey(PCUITEMID_CHILD* items, size_t count, uint32_t column, SORTDIRECTION direction) const
+    {
+        std::vector<std::pair<uint64_t, PCUITEMID_CHILD>> keys;
+        keys.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto key = TItem(items[i]).GetIntegerSortKey(column);
+            if (!key)
+                return false;
+
+            // Note: inverting the keys sorts descending and keeps the sort stable.
+            keys.emplace_back(direction == SORT_DESCENDING ? ~*key : *key, items[i]);
+        }
+
+        RadixSortByKey(keys);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            items[i] = keys[i].second;
+        }
+
+        return true;
+    }
+
+    bool SortItemsOnSortKey(PCUITEMID_CHILD* items, size_t count, uint32_t column, SORTDIRECTION direction) const
+    {
+        // Note: a key can be cached in the item object, the objects are kept alive (no reallocation) during the sort.
+        std::vector<TItem> itemObjects;
+        itemObjects.reserve(count);
+        std::vector<std::pair<std::string_view, PCUITEMID_CHILD>> keys;
+        keys.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto key = itemObjects.emplace_back(items[i]).GetSortKey(column);
+            if (key.empty())
+                return false;
+
+            keys.emplace_back(key, items[i]);
+        }
+
+        std::stable_sort(std::execution::par, keys.begin(), keys.end(), [direction](const auto& key1, const auto& key2) noexcept {
+            return direction == SORT_DESCENDING ? CompareSortKeys(key2.first, key1.first) < 0 : CompareSortKeys(key1.first, key2.first) < 0;
+        });
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            items[i] = keys[i].second;
+        }
+
+        return true;
+    }
+
+    ATL::CComPtr<IEnumIDList> CreateSortedEnumIDList(IEnumIDList* enumIdList, uint32_t column) const
+    {
+        constexpr ULONG batchSize = 256;
+        std::vector<PITEMID_CHILD> items;
+
+        try
+        {
+            for (;;)
+            {
+                const size_t offset = items.size();
+                items.resize(offset + batchSize);
+                ULONG fetched{};
+                const HRESULT result = enumIdList->Next(batchSize, items.data() + offset, &fetched);
+                items.resize(offset + fetched);
+                RaiseExceptionIfFailed(result);
+                if (result != S_OK)
+                    break;
+            }
+
+            // Note: a PITEMID_CHILD array can be sorted as a PCUITEMID_CHILD array.
+            SortItems(reinterpret_cast<PCUITEMID_CHILD*>(items.data()), items.size(), column);
+        }
+        catch (...)
+        {
+            StaticEnumIDList::FreeItems(items);
+            throw;
+        }
+
+        return StaticEnumIDList::CreateInstance(std::move(items));
+    }
+
     ItemIDList m_pidlFolder;
     ItemIDList m_junctionPoint;
     std::vector<ColumnInfo> m_columnInfos;
     HWND m_ownerWindow{};
     bool m_cachedIsSupportedClipboardFormat{};
+    mutable std::mutex m_enumCancellationMutex;
+    std::shared_ptr<const std::atomic<bool>> m_enumCancelled;
 };
 
 } // namespace msf
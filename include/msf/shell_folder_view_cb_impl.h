@@ -11,6 +11,10 @@
 #include "shell_uuids.h"
 #include "pidl.h"
 
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
 
 struct SFVM_WEBVIEW_CONTENT_DATA;
 
@@ -18,6 +22,23 @@ struct SFVM_WEBVIEW_CONTENT_DATA;
 namespace msf
 {
 
+/// <summary>Detects if a view callback enables background enumeration.</summary>
+/// <remarks>
+/// A view callback opts in by declaring: static constexpr bool EnableBackgroundEnumeration = true.
+/// The system folder view will then call EnumObjects and IEnumIDList::Next on a background thread,
+/// the enumerator of the folder must support this.
+/// </remarks>
+template<typename T, typename = void>
+struct HasBackgroundEnumeration : std::false_type
+{
+};
+
+template<typename T>
+struct HasBackgroundEnumeration<T, std::enable_if_t<T::EnableBackgroundEnumeration>> : std::true_type
+{
+};
+
+
 template <typename T>
 class __declspec(novtable) ShellFolderViewCBImpl :
     public IShellFolderViewCB,
@@ -196,6 +217,7 @@ class __declspec(novtable) ShellFolderViewCBImpl :
 
             case SFVM_WINDOWCLOSING:
                 ATLTRACE(L"ShellFolderViewCBImpl::IShellFolderViewCB::MessageSFVCB (OnWindowClosing)\n");
+                m_enumCancelled->store(true); // navigation away: a running background enumeration can stop.
                 break;
 
             case SFVM_ADDINGOBJECT:
@@ -369,9 +391,17 @@ class __declspec(novtable) ShellFolderViewCBImpl :
         ATLTRACENOTIMPL(L"ShellFolderViewCBImpl::IFolderViewSettings::GetGroupSubsetCount");
     }
 
+    // Purpose: returns the flag that is set when the view window closes (navigation away).
+    //          Pass it to the enumerator (see IEnumIDListImpl::SetCancellation) to stop a background enumeration.
+    [[nodiscard]] std::shared_ptr<const std::atomic<bool>> GetEnumCancellation() const noexcept
+    {
+        return m_enumCancelled;
+    }
+
 protected:
-    explicit ShellFolderViewCBImpl(long notifyevents = 0) noexcept :
-        m_notifyevents(notifyevents)
+    explicit ShellFolderViewCBImpl(long notifyevents = 0) :
+        m_notifyevents(notifyevents),
+        m_enumCancelled(std::make_shared<std::atomic<bool>>(false))
     {
         ATLTRACE(L"ShellFolderViewCBImpl::ShellFolderViewCBImpl (instance=%p)\n", this);
     }
@@ -379,6 +409,7 @@ class __declspec(novtable) ShellFolderViewCBImpl :
     ~ShellFolderViewCBImpl()
     {
         ATLTRACE(L"ShellFolderViewCBImpl::~ShellFolderViewCBImpl (instance=%p)\n", this);
+        m_enumCancelled->store(true);
     }
 
     // Purpose: Controls which folder (file) is watched for change events.
@@ -439,9 +470,17 @@ class __declspec(novtable) ShellFolderViewCBImpl :
         return E_NOTIMPL;
     }
 
+    // Purpose: called when the background enumeration has completed (see OnBackGroundEnum).
     HRESULT OnBackgroundEnumDone() noexcept
     {
-        return E_NOTIMPL;
+        if constexpr (HasBackgroundEnumeration<T>::value)
+        {
+            return S_OK;
+        }
+        else
+        {
+            return E_NOTIMPL;
+        }
     }
 
     HRESULT OnGetSortDefaults(int* /*piDirection*/, int* /*piColumn*/) noexcept
@@ -469,9 +508,18 @@ class __declspec(novtable) ShellFolderViewCBImpl :
         return E_NOTIMPL;
     }
 
+    // Purpose: S_OK requests the system folder view to enumerate on a background thread, which keeps
+    //          the window responsive for large folders. Enabled with EnableBackgroundEnumeration.
     HRESULT OnBackGroundEnum() noexcept
     {
-        return E_NOTIMPL;
+        if constexpr (HasBackgroundEnumeration<T>::value)
+        {
+            return S_OK;
+        }
+        else
+        {
+            return E_NOTIMPL;
+        }
     }
 
     HRESULT OnDidDragDrop(DWORD /*dwEffect*/, IDataObject* /*pIdo*/) noexcept
@@ -577,6 +625,7 @@ class __declspec(novtable) ShellFolderViewCBImpl :
     // Member variables.
     ItemIDList m_folder;
     long  m_notifyevents;
+    std::shared_ptr<std::atomic<bool>> m_enumCancelled;
 };
 
 } // msf namespace
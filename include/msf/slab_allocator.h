@@ -0,0 +1,160 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library),
+//       which makes it possible to test and measure the allocator outside Windows.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace msf
+{
+
+/// <summary>Size-class slab allocator for small, short-lived memory blocks.</summary>
+/// <remarks>
+/// Blocks are carved from large slabs that are retrieved from TBackingAllocator.
+/// Freed blocks are kept on a per size-class free list and reused, which makes
+/// Allocate/Free O(1) without a round trip to the backing allocator.
+/// Blocks larger than MaxBlockSize are passed directly to the backing allocator.
+/// TBackingAllocator must provide: static void* Allocate(size_t) (throws on failure)
+/// and static void Free(void*) noexcept.
+/// The class is not thread safe: use one instance per thread.
+/// </remarks>
+template<typename TBackingAllocator>
+class SlabAllocator final
+{
+public:
+    static constexpr size_t MinBlockSize = 32;
+    static constexpr size_t MaxBlockSize = 4096;
+    static constexpr size_t SizeClassCount = 8; // 32, 64, 128, ..., 4096
+    static constexpr size_t SlabSize = 64 * 1024;
+
+    SlabAllocator() = default;
+
+    ~SlabAllocator()
+    {
+        for (auto* slab : m_slabs)
+        {
+            TBackingAllocator::Free(slab);
+        }
+    }
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator(SlabAllocator&&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(SlabAllocator&&) = delete;
+
+    [[nodiscard]] void* Allocate(size_t size)
+    {
+        const size_t sizeClass = GetSizeClass(size);
+        if (sizeClass == LargeSizeClass)
+        {
+            auto* header = static_cast<BlockHeader*>(TBackingAllocator::Allocate(sizeof(BlockHeader) + size));
+            header->sizeClass = LargeSizeClass;
+            return header + 1;
+        }
+
+        FreeBlock*& freeList = m_freeLists[sizeClass];
+        if (!freeList)
+        {
+            AddSlab(sizeClass);
+        }
+
+        FreeBlock* block = freeList;
+        freeList = block->next;
+
+        auto* header = reinterpret_cast<BlockHeader*>(block);
+        header->sizeClass = static_cast<uint32_t>(sizeClass);
+        return header + 1;
+    }
+
+    void Free(void* p) noexcept
+    {
+        if (!p)
+            return;
+
+        auto* header = static_cast<BlockHeader*>(p) - 1;
+        const auto sizeClass = static_cast<uint32_t>(header->sizeClass);
+        if (sizeClass == LargeSizeClass)
+        {
+            TBackingAllocator::Free(header);
+            return;
+        }
+
+        // Note: the free list link overwrites the header, the block is unused from here.
+        auto* block = reinterpret_cast<FreeBlock*>(header);
+        block->next = m_freeLists[sizeClass];
+        m_freeLists[sizeClass] = block;
+    }
+
+    [[nodiscard]] size_t GetSlabCount() const noexcept
+    {
+        return m_slabs.size();
+    }
+
+    // Purpose: returns the size of the block that will be used for a request of 'size' bytes.
+    [[nodiscard]] static constexpr size_t GetBlockSize(size_t size) noexcept
+    {
+        const size_t sizeClass = GetSizeClass(size);
+        return sizeClass == LargeSizeClass ? size : MinBlockSize << sizeClass;
+    }
+
+private:
+    static constexpr uint32_t LargeSizeClass = 0xFFFFFFFF;
+
+    // Note: the 64 bit header keeps the payload 8 byte aligned (an alignment specifier would add padding, warning C4324).
+    struct BlockHeader
+    {
+        uint64_t sizeClass;
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    static_assert(sizeof(BlockHeader) == 8, "the block header must keep the payload 8 byte aligned");
+    static_assert(sizeof(BlockHeader) >= sizeof(FreeBlock), "free list link must fit in the block header");
+
+    [[nodiscard]] static constexpr size_t GetSizeClass(size_t size) noexcept
+    {
+        size_t sizeClass = 0;
+        size_t blockSize = MinBlockSize;
+        while (blockSize < size + sizeof(BlockHeader))
+        {
+            blockSize <<= 1;
+            ++sizeClass;
+        }
+
+        return sizeClass < SizeClassCount ? sizeClass : LargeSizeClass;
+    }
+
+    void AddSlab(size_t sizeClass)
+    {
+        const size_t blockSize = MinBlockSize << sizeClass;
+        m_slabs.reserve(m_slabs.size() + 1);
+        auto* slab = static_cast<std::byte*>(TBackingAllocator::Allocate(SlabSize));
+        m_slabs.push_back(slab);
+
+        // Thread all blocks of the new slab on the free list, lowest address first.
+        FreeBlock* head = m_freeLists[sizeClass];
+        for (size_t i = SlabSize / blockSize; i-- > 0;)
+        {
+            auto* block = reinterpret_cast<FreeBlock*>(slab + (i * blockSize));
+            block->next = head;
+            head = block;
+        }
+
+        m_freeLists[sizeClass] = head;
+    }
+
+    FreeBlock* m_freeLists[SizeClassCount]{};
+    std::vector<std::byte*> m_slabs;
+};
+
+} // namespace msf
@@ -0,0 +1,107 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace msf
+{
+
+/// <summary>Detects if an item type provides precomputed binary sort keys.</summary>
+/// <remarks>
+/// An item type opts in by implementing: std::string_view GetSortKey(uint32_t column) const noexcept.
+/// The returned key must order items for that column when compared byte-wise (unsigned),
+/// an empty key means that no key is available and the normal Compare function is used. Equal keys are also
+/// resolved by Compare. The key must stay valid as long as the item object exists. Don't store locale dependent
+/// keys in the PIDL: persisted PIDLs would keep the key of the locale in which they were created.
+/// </remarks>
+template<typename TItem, typename = void>
+struct HasSortKey : std::false_type
+{
+};
+
+template<typename TItem>
+struct HasSortKey<TItem, std::void_t<decltype(std::declval<const TItem&>().GetSortKey(uint32_t{}))>> : std::true_type
+{
+};
+
+template<typename TItem>
+constexpr bool HasSortKeyV = HasSortKey<TItem>::value;
+
+
+/// <summary>Detects if an item type provides integer sort keys.</summary>
+/// <remarks>
+/// An item type opts in by implementing: std::optional&lt;uint64_t&gt; GetIntegerSortKey(uint32_t column) const noexcept.
+/// The returned key must order items for that column, std::nullopt means that no key is available.
+/// </remarks>
+template<typename TItem, typename = void>
+struct HasIntegerSortKey : std::false_type
+{
+};
+
+template<typename TItem>
+struct HasIntegerSortKey<TItem, std::void_t<decltype(std::declval<const TItem&>().GetIntegerSortKey(uint32_t{}))>> : std::true_type
+{
+};
+
+template<typename TItem>
+constexpr bool HasIntegerSortKeyV = HasIntegerSortKey<TItem>::value;
+
+
+// Purpose: compares two binary sort keys, returns -1, 0 or 1.
+[[nodiscard]] inline int CompareSortKeys(std::string_view key1, std::string_view key2) noexcept
+{
+    // Note: char_traits<char>::compare compares as unsigned char (memcmp).
+    const int result = key1.compare(key2);
+    return (result > 0) - (result < 0);
+}
+
+
+// Purpose: stable LSD radix sort on a 64 bit key, 1 byte per pass.
+//          Passes in which all keys have the same byte value are skipped.
+template<typename TValue>
+void RadixSortByKey(std::vector<std::pair<uint64_t, TValue>>& values)
+{
+    if (values.size() < 2)
+        return;
+
+    std::vector<std::pair<uint64_t, TValue>> buffer(values.size());
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::array<size_t, 256> offsets{};
+        for (const auto& value : values)
+        {
+            ++offsets[(value.first >> shift) & 0xFF];
+        }
+
+        if (offsets[(values.front().first >> shift) & 0xFF] == values.size())
+            continue;
+
+        size_t offset = 0;
+        for (auto& count : offsets)
+        {
+            const size_t next = offset + count;
+            count = offset;
+            offset = next;
+        }
+
+        for (auto& value : values)
+        {
+            buffer[offsets[(value.first >> shift) & 0xFF]++] = std::move(value);
+        }
+
+        values.swap(buffer);
+    }
+}
+
+} // namespace msf
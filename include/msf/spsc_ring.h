@@ -0,0 +1,78 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library).
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace msf
+{
+
+/// <summary>Lock-free ring buffer for exactly 1 producer thread and 1 consumer thread.</summary>
+/// <remarks>
+/// TryPush may only be called by the producer, TryPop only by the consumer.
+/// The indices are free running and wrap around, Capacity must be a power of 2.
+/// </remarks>
+template<typename TValue, size_t Capacity>
+class SpscRing final
+{
+public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+    static_assert(std::is_trivially_copyable_v<TValue>, "values are copied without construction or destruction");
+
+    SpscRing() = default;
+    ~SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing(SpscRing&&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    SpscRing& operator=(SpscRing&&) = delete;
+
+    [[nodiscard]] bool TryPush(TValue value) noexcept
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+            return false; // full.
+
+        m_values[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] bool TryPop(TValue& value) noexcept
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false; // empty.
+
+        value = m_values[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] bool IsEmpty() const noexcept
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool IsFull() const noexcept
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire) == Capacity;
+    }
+
+private:
+    // Note: the padding puts the indices on separate cache lines, which prevents false sharing between producer
+    //       and consumer. An alignment specifier would do the same, but causes warning C4324.
+    std::atomic<size_t> m_head{};
+    std::byte m_padding[64]{};
+    std::atomic<size_t> m_tail{};
+    std::array<TValue, Capacity> m_values{};
+};
+
+} // namespace msf
@@ -0,0 +1,110 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+#pragma once
+
+#include "msf_base.h"
+#include "pidl.h"
+
+#include <vector>
+
+namespace msf
+{
+
+// Purpose: copy policy class: required for the ATL::CComEnumOnSTL template.
+class ItemIdListToItemIdList
+{
+public:
+    static void init(PITEMID_CHILD* pidl) noexcept
+    {
+        *pidl = nullptr;
+    }
+
+    static HRESULT copy(PITEMID_CHILD* to, const PITEMID_CHILD* from) noexcept
+    {
+        try
+        {
+            *to = static_cast<PITEMID_CHILD>(ItemIDList::Clone(*from));
+            return S_OK;
+        }
+        catch (...)
+        {
+            return ExceptionToHResult();
+        }
+    }
+
+    static void destroy(PITEMID_CHILD* pidl) noexcept
+    {
+        CoTaskMemFree(*pidl);
+    }
+};
+
+
+// Purpose: IEnumIDList implementation over a fixed list of items. Used for pre-sorted enumerations.
+class StaticEnumIDList :
+    public ATL::CComEnumOnSTL<IEnumIDList,
+                              &IID_IEnumIDList,             // name and IID of enumerator interface
+                              PITEMID_CHILD,                // type of object to return
+                              ItemIdListToItemIdList,       // copy policy class
+                              std::vector<PITEMID_CHILD>>   // type of collection holding the data
+{
+public:
+    StaticEnumIDList(const StaticEnumIDList&) = delete;
+    StaticEnumIDList(StaticEnumIDList&&) = delete;
+    StaticEnumIDList& operator=(const StaticEnumIDList&) = delete;
+    StaticEnumIDList& operator=(StaticEnumIDList&&) = delete;
+
+    // Purpose: creates an enumerator that takes ownership of the passed items.
+    static ATL::CComPtr<IEnumIDList> CreateInstance(std::vector<PITEMID_CHILD>&& items)
+    {
+        ATL::CComObject<StaticEnumIDList>* enumIdList;
+        const HRESULT hr = ATL::CComObject<StaticEnumIDList>::CreateInstance(&enumIdList);
+        if (FAILED(hr))
+        {
+            FreeItems(items);
+            RaiseException(hr);
+        }
+
+        ATL::CComPtr<IEnumIDList> enumPtr(enumIdList);
+        enumIdList->Initialize(std::move(items));
+
+        return enumPtr;
+    }
+
+    static void FreeItems(std::vector<PITEMID_CHILD>& items) noexcept
+    {
+        for (auto* pidl : items)
+        {
+            CoTaskMemFree(pidl);
+        }
+
+        items.clear();
+    }
+
+protected:
+    StaticEnumIDList() noexcept
+    {
+        ATLTRACE(L"StaticEnumIDList::StaticEnumIDList (instance=%p)\n", this);
+    }
+
+    ~StaticEnumIDList()
+    {
+        ATLTRACE(L"StaticEnumIDList::~StaticEnumIDList (instance=%p)\n", this);
+        FreeItems(m_items);
+    }
+
+private:
+    void Initialize(std::vector<PITEMID_CHILD>&& items) noexcept
+    {
+        m_items = std::move(items);
+
+        ATLVERIFY(SUCCEEDED(__super::Init(this, m_items)));
+    }
+
+    // Member variables.
+    std::vector<PITEMID_CHILD> m_items;
+};
+
+} // namespace msf
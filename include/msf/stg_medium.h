@@ -12,6 +12,70 @@
 
 namespace msf {
 
+/// <summary>Owner of a HGLOBAL that is shared by multiple STGMEDIUMs (as pUnkForRelease).</summary>
+/// <remarks>
+/// ReleaseStgMedium releases pUnkForRelease instead of freeing the HGLOBAL, the memory is freed
+/// when the last STGMEDIUM that shares it is released.
+/// </remarks>
+class SharedGlobalOwner final : public IUnknown
+{
+public:
+    // Purpose: takes ownership of the passed memory, the returned owner has a reference count of 1.
+    static IUnknown* Create(HGLOBAL global)
+    {
+        return new SharedGlobalOwner(global);
+    }
+
+    SharedGlobalOwner(const SharedGlobalOwner&) = delete;
+    SharedGlobalOwner(SharedGlobalOwner&&) = delete;
+    SharedGlobalOwner& operator=(const SharedGlobalOwner&) = delete;
+    SharedGlobalOwner& operator=(SharedGlobalOwner&&) = delete;
+
+    HRESULT __stdcall QueryInterface(REFIID interfaceId, void** object) noexcept override
+    {
+        if (interfaceId != IID_IUnknown)
+        {
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        *object = static_cast<IUnknown*>(this);
+        AddRef();
+        return S_OK;
+    }
+
+    ULONG __stdcall AddRef() noexcept override
+    {
+        return static_cast<ULONG>(InterlockedIncrement(&m_referenceCount));
+    }
+
+    ULONG __stdcall Release() noexcept override
+    {
+        const auto referenceCount = static_cast<ULONG>(InterlockedDecrement(&m_referenceCount));
+        if (referenceCount == 0)
+        {
+            delete this;
+        }
+
+        return referenceCount;
+    }
+
+private:
+    explicit SharedGlobalOwner(HGLOBAL global) noexcept :
+        m_global{global}
+    {
+    }
+
+    ~SharedGlobalOwner()
+    {
+        GlobalFree(m_global);
+    }
+
+    HGLOBAL m_global;
+    LONG m_referenceCount{1};
+};
+
+
 // A StorageMedium class is owner of the stgmedium.
 
 /// <summary>Smart extender class for Windows SDK STGMEDIUM struct.</summary>
@@ -101,15 +165,46 @@ class StorageMedium final : public STGMEDIUM
         return *this;
     }
 
+    // Purpose: copies the medium for a receiver that will call ReleaseStgMedium.
+    //          A HGLOBAL is cloned: the receiver gets its own memory that it may modify.
     void CopyTo(STGMEDIUM& stgmedium) const
+    {
+        if (tymed == TYMED_HGLOBAL)
+        {
+            SetHGlobal(stgmedium, GlobalClone(GetHGlobal()));
+            return;
+        }
+
+        CopyReferenceTo(stgmedium);
+    }
+
+    // Purpose: as CopyTo, but a HGLOBAL is shared instead of cloned. The first shared copy moves the ownership
+    //          of the memory to a reference counted owner, that is passed as pUnkForRelease.
+    //          Only use it for receivers that don't modify the memory.
+    void ShareTo(STGMEDIUM& stgmedium)
+    {
+        if (tymed == TYMED_HGLOBAL && !pUnkForRelease)
+        {
+            pUnkForRelease = SharedGlobalOwner::Create(hGlobal);
+        }
+
+        CopyReferenceTo(stgmedium);
+    }
+
+private:
+    void CopyReferenceTo(STGMEDIUM& stgmedium) const noexcept
     {
         stgmedium.tymed          = tymed;
         stgmedium.pUnkForRelease = pUnkForRelease;
+        if (pUnkForRelease)
+        {
+            pUnkForRelease->AddRef();
+        }
 
         switch (tymed)
         {
         case TYMED_HGLOBAL:
-            stgmedium.hGlobal = GlobalClone(GetHGlobal());
+            stgmedium.hGlobal = hGlobal;
             break;
 
         case TYMED_ISTREAM:
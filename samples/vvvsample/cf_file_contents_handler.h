@@ -12,6 +12,9 @@
 
 // Note: owner of the instance of this class must keep passed data object alive.
 //       This class doesn't do increase the reference count to prevent circular referencing.
+//       The content is provided as a stream that is generated on demand, TYMED_HGLOBAL is
+//       only supported for consumers that cannot handle streams and only for items up to MAX_VVV_ITEM_SIZE:
+//       the HGLOBAL always contains the complete item, as announced by the file descriptor.
 
 class CfFileContentsHandler final : public msf::ClipboardFormatHandler
 {
@@ -28,18 +31,34 @@ class CfFileContentsHandler final : public msf::ClipboardFormatHandler
     CfFileContentsHandler& operator=(const CfFileContentsHandler&) = delete;
     CfFileContentsHandler& operator=(CfFileContentsHandler&&) = delete;
 
+    DWORD GetTymed() const noexcept override
+    {
+        return TYMED_ISTREAM | TYMED_HGLOBAL;
+    }
+
     HRESULT Validate(const FORMATETC& formatEtc) const noexcept override
     {
         if (formatEtc.dwAspect != DVASPECT_CONTENT)
             return DV_E_DVASPECT;
 
-        if (!msf::IsBitSet(formatEtc.tymed, TYMED_HGLOBAL))
+        if (!msf::IsBitSet(formatEtc.tymed, TYMED_ISTREAM) && !msf::IsBitSet(formatEtc.tymed, TYMED_HGLOBAL))
             return DV_E_TYMED;
 
-        if (static_cast<uint32_t>(formatEtc.lindex) >= GetCfShellIdList()->size())
-            return DV_E_LINDEX;
+        try
+        {
+            if (static_cast<uint32_t>(formatEtc.lindex) >= GetCfShellIdList()->size())
+                return DV_E_LINDEX;
+
+            if (!msf::IsBitSet(formatEtc.tymed, TYMED_ISTREAM) &&
+                VVVItem(GetCfShellIdList()->GetItem(static_cast<uint32_t>(formatEtc.lindex))).GetSize() > MAX_VVV_ITEM_SIZE)
+                return DV_E_TYMED;
 
-        return S_OK;
+            return S_OK;
+        }
+        catch (...)
+        {
+            return msf::ExceptionToHResult();
+        }
     }
 
     void GetData(const FORMATETC& formatEtc, STGMEDIUM& medium) const override
@@ -48,7 +67,20 @@ class CfFileContentsHandler final : public msf::ClipboardFormatHandler
 
         const VVVItem vvvItem(GetCfShellIdList()->GetItem(static_cast<uint32_t>(formatEtc.lindex)));
 
-        const size_t size = std::min(vvvItem.GetSize(), MAX_VVV_ITEM_SIZE);
+        if (msf::IsBitSet(formatEtc.tymed, TYMED_ISTREAM))
+        {
+            // VVV items have no real content, the stream produces zeros.
+            auto stream = msf::GeneratorStream::CreateInstance(vvvItem.GetSize(),
+                [](uint64_t /*offset*/, std::byte* buffer, size_t size) noexcept { std::fill_n(buffer, size, std::byte{}); },
+                vvvItem.GetDisplayName());
+
+            medium.tymed = TYMED_ISTREAM;
+            medium.pstm = stream.Detach();
+            medium.pUnkForRelease = nullptr;
+            return;
+        }
+
+        const size_t size = vvvItem.GetSize();
         const HGLOBAL hg = msf::GlobalAllocThrow(size);
         ZeroMemory(hg, size);
 
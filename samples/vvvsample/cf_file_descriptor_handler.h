@@ -10,16 +10,18 @@
 #include <msf.h>
 
 #include <strsafe.h>
+#include <algorithm>
+#include <vector>
 
-// Note: owner of the instance of this class must keep passed data object alive.
-//       This class doesn't do increases the reference count to prevent circular referencing.
+// Note: the passed data object is only used by the constructor: the item set of a data object is fixed,
+//       the descriptors are created once and the handler doesn't keep a reference to the data object.
 
 class CfFileDescriptorHandler final : public msf::ClipboardFormatHandler
 {
 public:
     explicit CfFileDescriptorHandler(IDataObject* dataObject) :
-        ClipboardFormatHandler(CFSTR_FILEDESCRIPTOR, true, false),
-        m_dataObject(dataObject)
+        ClipboardFormatHandler(CFSTR_FILEDESCRIPTORW, true, false),
+        m_fileGroupDescriptor{CreateFileGroupDescriptor(dataObject)}
     {
     }
 
@@ -29,33 +31,41 @@ class CfFileDescriptorHandler final : public msf::ClipboardFormatHandler
     CfFileDescriptorHandler& operator=(const CfFileDescriptorHandler&) = delete;
     CfFileDescriptorHandler& operator=(CfFileDescriptorHandler&&) = delete;
 
+    // Purpose: every request gets its own copy of the descriptors.
     void GetData(const FORMATETC&, STGMEDIUM& medium) const override
     {
-        const msf::CfShellIdList cfshellidlist{m_dataObject};
+        const HGLOBAL hg = msf::GlobalAllocThrow(m_fileGroupDescriptor.size());
+        memcpy(hg, m_fileGroupDescriptor.data(), m_fileGroupDescriptor.size());
+        msf::StorageMedium::SetHGlobal(medium, hg);
+    }
 
-        // Note: FILEGROUPDESCRIPTOR provides the count and 1 FILEDESCRIPTOR.
-        const size_t size = sizeof(FILEGROUPDESCRIPTOR) + ((cfshellidlist.size() - 1) * sizeof(FILEDESCRIPTOR)); // -V119
+private:
+    [[nodiscard]] static std::vector<std::byte> CreateFileGroupDescriptor(IDataObject* dataObject)
+    {
+        const msf::CfShellIdList cfshellidlist{dataObject};
 
-        const HGLOBAL hg = msf::GlobalAllocThrow(size);
-        auto* fileGroupDescriptor = static_cast<FILEGROUPDESCRIPTOR*>(hg);
+        // Note: FILEGROUPDESCRIPTORW provides the count and 1 FILEDESCRIPTORW.
+        const size_t itemCount = cfshellidlist.size();
+        std::vector<std::byte> buffer(sizeof(FILEGROUPDESCRIPTORW) + ((std::max(itemCount, size_t{1}) - 1) * sizeof(FILEDESCRIPTORW)));
+        auto* fileGroupDescriptor = reinterpret_cast<FILEGROUPDESCRIPTORW*>(buffer.data());
 
-        fileGroupDescriptor->cItems = static_cast<uint32_t>(cfshellidlist.size());
+        fileGroupDescriptor->cItems = static_cast<uint32_t>(itemCount);
         for (unsigned int i = 0; i < fileGroupDescriptor->cItems; ++i)
         {
-            FILEDESCRIPTOR& fd = fileGroupDescriptor->fgd[i];
-
-            fd.dwFlags = FD_FILESIZE;
-            fd.nFileSizeHigh = 0;
-
             const VVVItem vvvItem(cfshellidlist.GetItem(i));
 
-            fd.nFileSizeLow = std::min(vvvItem.GetSize(), MAX_VVV_ITEM_SIZE);
-            msf::RaiseExceptionIfFailed(StringCchCopy(fd.cFileName, MAX_PATH, vvvItem.GetDisplayName().c_str()));
+            // Note: VVV items have no timestamps, FD_WRITESTIME and friends are not set.
+            FILEDESCRIPTORW& fd = fileGroupDescriptor->fgd[i];
+            fd.dwFlags = FD_FILESIZE | FD_ATTRIBUTES | FD_UNICODE;
+            const uint64_t size = vvvItem.GetSize(); // the content stream provides the complete item.
+            fd.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+            fd.nFileSizeLow = static_cast<DWORD>(size);
+            fd.dwFileAttributes = vvvItem.IsFolder() ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+            msf::RaiseExceptionIfFailed(StringCchCopyW(fd.cFileName, MAX_PATH, vvvItem.GetDisplayName().c_str()));
         }
 
-        msf::StorageMedium::SetHGlobal(medium, hg);
+        return buffer;
     }
 
-private:
-    IDataObject* m_dataObject;
+    const std::vector<std::byte> m_fileGroupDescriptor;
 };
@@ -21,7 +21,8 @@ class __declspec(novtable) EnumIDList :
         COM_INTERFACE_ENTRY(IEnumIDList)
     END_COM_MAP()
 
-    static ATL::CComPtr<IEnumIDList> CreateInstance(const std::wstring& filename, const std::wstring& folder, DWORD grfFlags)
+    static ATL::CComPtr<IEnumIDList> CreateInstance(const std::wstring& filename, const std::shared_ptr<const VVVSectionHandle>& folder, DWORD grfFlags,
+                                                    std::shared_ptr<const std::atomic<bool>> cancelled)
     {
         ATL::CComObject<EnumIDList>* instance;
         const HRESULT hr = ATL::CComObject<EnumIDList>::CreateInstance(&instance);
@@ -29,7 +30,7 @@ class __declspec(novtable) EnumIDList :
             msf::RaiseException(hr);
 
         ATL::CComPtr<IEnumIDList> enumIdList(instance);
-        instance->Initialize(filename, folder, grfFlags);
+        instance->Initialize(filename, folder, grfFlags, std::move(cancelled));
         return enumIdList;
     }
 
@@ -44,10 +45,12 @@ class __declspec(novtable) EnumIDList :
     }
 
 private:
-    void Initialize(const std::wstring& filename, const std::wstring& folder, DWORD grfFlags)
+    void Initialize(const std::wstring& filename, const std::shared_ptr<const VVVSectionHandle>& folder, DWORD grfFlags,
+                    std::shared_ptr<const std::atomic<bool>> cancelled)
     {
         m_file = std::make_unique<VVVFile>(filename, folder);
         m_grfFlags = grfFlags;
+        SetCancellation(std::move(cancelled)); // the view stops the background enumeration when it closes.
     }
 
     // Member variables
@@ -14,6 +14,9 @@
 #include "vvv_item.h"
 #include "vvv_property_sheet.h"
 
+#include <filesystem>
+#include <memory>
+
 using std::make_unique;
 using std::wstring;
 
@@ -55,26 +58,27 @@ class __declspec(novtable) ShellFolder :
     }
 
     // Purpose: called by msf when the shell folder needs to show a sub folder.
+    //          The handle is passed to all VVVFile instances, the section is only resolved once.
     void InitializeSubFolder(const std::vector<VVVItem>& items)
     {
-        m_strSubFolder.clear();
-
+        std::vector<unsigned int> itemIds;
+        itemIds.reserve(items.size());
         for (const auto& item : items)
         {
-            if (!m_strSubFolder.empty())
-            {
-                m_strSubFolder += L"\\";
-            }
-
-            m_strSubFolder += std::to_wstring(item.GetID());
+            itemIds.push_back(item.GetID());
         }
+
+        m_subFolder = std::make_shared<const VVVSectionHandle>(std::move(itemIds));
     }
 
     // Purpose: Create the shellfolderviewcb that will be used to catch callback events
     //          generated by the system folder view.
-    [[nodiscard]] ATL::CComPtr<IShellFolderViewCB> CreateShellFolderViewCB() const
+    [[nodiscard]] ATL::CComPtr<IShellFolderViewCB> CreateShellFolderViewCB()
     {
-        return ShellFolderViewCB::CreateInstance(GetRootFolder());
+        std::shared_ptr<const std::atomic<bool>> enumCancelled;
+        auto shellFolderViewCB = ShellFolderViewCB::CreateInstance(GetRootFolder(), enumCancelled);
+        SetEnumCancellation(std::move(enumCancelled));
+        return shellFolderViewCB;
     }
 
     // Purpose: called by msf/shell when a number of items are selected and a IDataObject
@@ -88,7 +92,13 @@ class __declspec(novtable) ShellFolder :
     //          all items  The shell will walk all IDs and then release the enum.
     ATL::CComPtr<IEnumIDList> CreateEnumIDList(HWND /*hwnd*/, DWORD grfFlags) const
     {
-        return EnumIDList::CreateInstance(GetPathJunctionPoint(), m_strSubFolder, grfFlags);
+        return EnumIDList::CreateInstance(GetPathJunctionPoint(), m_subFolder, grfFlags, GetEnumCancellation());
+    }
+
+    // Purpose: called by msf when items of the folder were changed, the cached content of the file is no longer valid.
+    void OnItemsChanged() const
+    {
+        VVVFile::InvalidateCache(GetPathJunctionPoint());
     }
 
     // Purpose: called by msf when there is no global settings for all items.
@@ -176,7 +186,10 @@ class __declspec(novtable) ShellFolder :
 
         msf::ItemIDList pidl(VVVItem::CreateItemIdList(item.GetID(), item.GetSize(), item.IsFolder(), szNewName));
 
-        VVVFile(GetPathJunctionPoint(), m_strSubFolder).SetItem(VVVItem(pidl.GetRelative()));
+        const VVVFile vvvFile(GetPathJunctionPoint(), m_subFolder);
+        VVVFile::Transaction transaction(vvvFile);
+        transaction.SetItem(VVVItem(pidl.GetRelative()));
+        transaction.Commit();
 
         return pidl.DetachRelative();
     }
@@ -192,7 +205,7 @@ class __declspec(novtable) ShellFolder :
         long wEventId;
         if (VVVPropertySheet(item, this).DoModal(hwnd, wEventId) > 0 && wEventId != 0)
         {
-            const VVVFile vvvFile(GetPathJunctionPoint(), m_strSubFolder);
+            const VVVFile vvvFile(GetPathJunctionPoint(), m_subFolder);
             vvvFile.SetItem(item);
         }
 
@@ -205,7 +218,10 @@ class __declspec(novtable) ShellFolder :
         if (!hwnd && !UserConfirmsFileDelete(hwnd, items))
             return 0; // user wants to abort the file deletion process.
 
-        VVVFile(GetPathJunctionPoint(), m_strSubFolder).DeleteItems(items);
+        const VVVFile vvvFile(GetPathJunctionPoint(), m_subFolder);
+        VVVFile::Transaction transaction(vvvFile);
+        transaction.DeleteItems(items);
+        transaction.Commit();
 
         return SHCNE_DELETE;
     }
@@ -219,13 +235,34 @@ class __declspec(novtable) ShellFolder :
     // Purpose: called when items are pasted or dropped on the shellfolder.
     DWORD AddItemsFromDataObject(DWORD effectMask, IDataObject* dataObject) const
     {
-        msf::ClipboardFormatHDrop clipboardFormat(dataObject);
-
-        const auto fileCount = clipboardFormat.GetFileCount();
-        for (unsigned int i = 0; i < fileCount; ++i)
-        {
-            AddItem(clipboardFormat.GetFile(i));
-        }
+        const msf::ClipboardFormatHDrop clipboardFormat(dataObject);
+
+        // Note: the sizes of the files are read in parallel, all items are added with 1 write action
+        //       and the shell is notified with 1 batch, after the commit.
+        const msf::IngestionPipeline<std::wstring_view, DroppedFile> pipeline(
+            [](const std::wstring_view& file) { return ReadDroppedFile(file); },
+            [this](std::vector<DroppedFile>& files) {
+                const VVVFile vvvFile(GetPathJunctionPoint(), m_subFolder);
+                VVVFile::Transaction transaction(vvvFile);
+                for (auto& file : files)
+                {
+                    file.item = std::make_unique<msf::ItemIDList>(transaction.AddItem(file.size, file.name));
+                }
+
+                transaction.Commit();
+            },
+            [this](const std::vector<DroppedFile>& files) {
+                std::vector<PCUIDLIST_RELATIVE> items;
+                items.reserve(files.size());
+                for (const auto& file : files)
+                {
+                    items.push_back(file.item->GetRelative());
+                }
+
+                ReportAddItems(items);
+            });
+
+        pipeline.Run(clipboardFormat.GetFiles());
 
         // The VVV sample cannot use optimized move. Just return effectMask as passed.
         return effectMask;
@@ -255,6 +292,20 @@ class __declspec(novtable) ShellFolder :
     }
 
 private:
+    struct DroppedFile
+    {
+        std::wstring name;
+        unsigned int size{};
+        std::unique_ptr<msf::ItemIDList> item; // set by the commit stage.
+    };
+
+    // Note: called concurrently by the ingestion pipeline.
+    static DroppedFile ReadDroppedFile(std::wstring_view file)
+    {
+        const std::wstring path(file);
+        return {PathFindFileName(path.c_str()), static_cast<unsigned int>(std::filesystem::file_size(path)), {}};
+    }
+
     // Purpose: Ask the user if he is really sure about the file delete action.
     //          Deleted files cannot be restored from the recycle bin.
     static bool UserConfirmsFileDelete(HWND hwnd, const std::vector<VVVItem>& items)
@@ -277,15 +328,6 @@ class __declspec(novtable) ShellFolder :
                                         msf::LoadResourceString(nCaptionResId).c_str(), MB_YESNO | MB_ICONQUESTION) == IDYES;
     }
 
-    void AddItem(const wstring& strFile) const
-    {
-        VVVFile vvvfile(GetPathJunctionPoint(), m_strSubFolder);
-
-        msf::ItemIDList pidlItem(vvvfile.AddItem(strFile));
-
-        ReportAddItem(pidlItem.GetRelative());
-    }
-
     static bool IsReadOnly(const wstring& strFileName) noexcept
     {
         const auto attributes = GetFileAttributes(strFileName.c_str());
@@ -293,7 +335,7 @@ class __declspec(novtable) ShellFolder :
     }
 
     // Member variables
-    wstring m_strSubFolder;
+    std::shared_ptr<const VVVSectionHandle> m_subFolder;
 };
 
 
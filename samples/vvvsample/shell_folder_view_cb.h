@@ -13,7 +13,8 @@ class __declspec(novtable) ShellFolderViewCB :
     public msf::ShellFolderViewCBImpl<ShellFolderViewCB>
 {
 public:
-    static ATL::CComPtr<IShellFolderViewCB> CreateInstance(PCUIDLIST_RELATIVE folder)
+    // Purpose: creates the callback, enumCancelled receives the flag that is set when the view closes.
+    static ATL::CComPtr<IShellFolderViewCB> CreateInstance(PCUIDLIST_RELATIVE folder, std::shared_ptr<const std::atomic<bool>>& enumCancelled)
     {
         ATL::CComObject<ShellFolderViewCB>* instance;
         const HRESULT hr = ATL::CComObject<ShellFolderViewCB>::CreateInstance(&instance);
@@ -22,6 +23,7 @@ class __declspec(novtable) ShellFolderViewCB :
 
         ATL::CComPtr<IShellFolderViewCB> shellfolderviewcb(instance);
         instance->SetFolder(folder);
+        enumCancelled = instance->GetEnumCancellation();
         return shellfolderviewcb;
     }
 
@@ -32,7 +34,11 @@ class __declspec(novtable) ShellFolderViewCB :
         COM_INTERFACE_ENTRY(IFolderViewSettings)
     END_COM_MAP()
 
-    ShellFolderViewCB() noexcept :
+    // The VVV enumerator only reads the shared, read-only container (an in memory copy of the file, guarded by
+    // the container cache): it can be used by the background thread of the view.
+    static constexpr bool EnableBackgroundEnumeration = true;
+
+    ShellFolderViewCB() :
         ShellFolderViewCBImpl<ShellFolderViewCB>(SHCNE_RENAMEITEM |
                                                   SHCNE_RENAMEFOLDER |
                                                   SHCNE_DELETE |
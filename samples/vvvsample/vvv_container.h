@@ -0,0 +1,811 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software license.
+//
+#pragma once
+
+// Note: this header is portable on purpose (only depends on the C++ standard library),
+//       which makes it possible to test and measure the container format outside Windows.
+//       All values are stored in little-endian byte order, strings are stored as UTF-16.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Layout of a binary .vvv container:
+//   VVVContainerHeader
+//   VVVFolderIndexHeader                   version 3 and later.
+//   VVVSectionTreeHeader                   version 4 and later.
+//   VVVSectionRecord[sectionCount]         sorted by path, the root folder has the empty path.
+//   VVVSectionFolderIndex[sectionCount]    version 3 and later, same order as the sections.
+//   VVVSectionChildIndex[sectionCount]     version 4 and later, same order as the sections.
+//   VVVItemRecord[itemCount]               the items of a section are stored contiguously, index = item slot.
+//   uint32_t[folderSlotCount]              version 3 and later, the slots of the active folder items per section.
+//   VVVSectionChild[childCount]            version 4 and later, the child sections per section, sorted by item ID.
+//   string pool                            UTF-16 strings, not zero terminated.
+//
+// A section describes one (sub)folder, its path is the '\' separated list of the folder item IDs.
+// The folder index makes it possible to enumerate only the folders of a section (navigation pane)
+// without reading the records of the other items.
+// The section tree links every section to the sections of its sub folders, a folder at depth d is
+// found with d lookups, without building or comparing path strings.
+
+constexpr uint32_t VVVContainerSignature = 0x43565656; // "VVVC"
+constexpr uint16_t VVVContainerVersion = 4; // version 2: firstFreeSlot is maintained, version 3: folder index, version 4: section tree.
+
+struct VVVStringRef
+{
+    uint32_t offset; // in bytes, relative to the start of the string pool.
+    uint32_t length; // in characters.
+};
+
+struct VVVContainerHeader
+{
+    uint32_t signature;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t sectionCount;
+    uint32_t sectionTableOffset;
+    uint32_t itemCount;
+    uint32_t itemTableOffset;
+    uint32_t stringPoolOffset;
+    uint32_t stringPoolSize; // in bytes
+};
+
+struct VVVFolderIndexHeader
+{
+    uint32_t sectionFolderIndexOffset;
+    uint32_t folderSlotTableOffset;
+    uint32_t folderSlotCount;
+    uint32_t reserved;
+};
+
+struct VVVSectionFolderIndex
+{
+    uint32_t firstFolderSlot; // index in the folder slot table.
+    uint32_t folderCount;
+};
+
+struct VVVSectionTreeHeader
+{
+    uint32_t sectionChildIndexOffset;
+    uint32_t childTableOffset;
+    uint32_t childCount;
+    uint32_t reserved;
+};
+
+struct VVVSectionChildIndex
+{
+    uint32_t firstChild; // index in the child table.
+    uint32_t childCount;
+};
+
+struct VVVSectionChild
+{
+    uint32_t itemId;
+    uint32_t section;
+};
+
+struct VVVSectionRecord
+{
+    VVVStringRef path;
+    VVVStringRef label;
+    uint32_t fileCount;
+    uint32_t firstItem;
+    uint32_t itemCount;
+    uint32_t firstFreeSlot; // all slots before firstFreeSlot are active (0 in version 1 containers).
+};
+
+enum VVVItemFlags : uint8_t
+{
+    VVVItemFlagActive = 0x01,
+    VVVItemFlagFolder = 0x02
+};
+
+struct VVVItemRecord
+{
+    uint32_t size;
+    uint32_t nameOffset; // in bytes, relative to the start of the string pool.
+    uint16_t nameLength; // in characters.
+    uint8_t  flags;
+    uint8_t  reserved1;
+    uint32_t reserved2;
+
+    [[nodiscard]] bool IsActive() const noexcept
+    {
+        return (flags & VVVItemFlagActive) != 0;
+    }
+
+    [[nodiscard]] bool IsFolder() const noexcept
+    {
+        return (flags & VVVItemFlagFolder) != 0;
+    }
+};
+
+static_assert(sizeof(VVVContainerHeader) == 32);
+static_assert(sizeof(VVVFolderIndexHeader) == 16);
+static_assert(sizeof(VVVSectionFolderIndex) == 8);
+static_assert(sizeof(VVVSectionTreeHeader) == 16);
+static_assert(sizeof(VVVSectionChildIndex) == 8);
+static_assert(sizeof(VVVSectionChild) == 8);
+static_assert(sizeof(VVVSectionRecord) == 32);
+static_assert(sizeof(VVVItemRecord) == 16);
+
+
+// Purpose: zero-copy, read-only view on a binary container (for example a memory mapped file).
+//          The constructor validates all offsets, after that all access is without checks.
+class VVVContainerView final
+{
+public:
+    VVVContainerView() = default;
+
+    VVVContainerView(const std::byte* data, size_t size) :
+        m_data{data}
+    {
+        if (!IsContainer(data, size))
+            throw std::invalid_argument("not a vvv container");
+
+        std::memcpy(&m_header, data, sizeof m_header);
+        if (m_header.version > VVVContainerVersion || m_header.headerSize < sizeof m_header)
+            throw std::invalid_argument("unsupported vvv container version");
+
+        CheckRange(m_header.sectionTableOffset, uint64_t{m_header.sectionCount} * sizeof(VVVSectionRecord), size);
+        CheckRange(m_header.itemTableOffset, uint64_t{m_header.itemCount} * sizeof(VVVItemRecord), size);
+        CheckRange(m_header.stringPoolOffset, m_header.stringPoolSize, size);
+
+        for (uint32_t i = 0; i < m_header.sectionCount; ++i)
+        {
+            const auto& section = GetSection(i);
+            CheckString(section.path);
+            CheckString(section.label);
+            if (uint64_t{section.firstItem} + section.itemCount > m_header.itemCount || section.firstFreeSlot > section.itemCount)
+                throw std::invalid_argument("corrupt vvv container");
+
+            if (i > 0 && !(GetString(GetSection(i - 1).path) < GetString(section.path)))
+                throw std::invalid_argument("corrupt vvv container");
+        }
+
+        for (uint32_t i = 0; i < m_header.itemCount; ++i)
+        {
+            const auto& item = GetItemTable()[i];
+            CheckString({item.nameOffset, item.nameLength});
+        }
+
+        if (m_header.version >= 3)
+        {
+            LoadFolderIndex(size);
+        }
+
+        if (m_header.version >= 4)
+        {
+            LoadSectionTree(size);
+        }
+    }
+
+    [[nodiscard]] static bool IsContainer(const std::byte* data, size_t size) noexcept
+    {
+        uint32_t signature;
+        if (size < sizeof(VVVContainerHeader))
+            return false;
+
+        std::memcpy(&signature, data, sizeof signature);
+        return signature == VVVContainerSignature;
+    }
+
+    [[nodiscard]] uint32_t GetSectionCount() const noexcept
+    {
+        return m_header.sectionCount;
+    }
+
+    [[nodiscard]] const VVVSectionRecord& GetSection(uint32_t index) const noexcept
+    {
+        return reinterpret_cast<const VVVSectionRecord*>(m_data + m_header.sectionTableOffset)[index];
+    }
+
+    // Purpose: returns the section of a folder or nullptr if the folder has no section (binary search).
+    [[nodiscard]] const VVVSectionRecord* FindSection(std::u16string_view path) const noexcept
+    {
+        uint32_t first = 0;
+        uint32_t last = m_header.sectionCount;
+        while (first < last)
+        {
+            const uint32_t middle = first + ((last - first) / 2);
+            const auto& section = GetSection(middle);
+            const int result = GetString(section.path).compare(path);
+            if (result == 0)
+                return &section;
+
+            if (result < 0)
+            {
+                first = middle + 1;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+
+        return nullptr;
+    }
+
+    [[nodiscard]] uint32_t GetSectionIndex(const VVVSectionRecord& section) const noexcept
+    {
+        return static_cast<uint32_t>(&section - &GetSection(0));
+    }
+
+    // Purpose: version 4 containers link every section to the sections of its sub folders.
+    [[nodiscard]] bool HasSectionTree() const noexcept
+    {
+        return m_sectionTree.childTableOffset != 0;
+    }
+
+    // Purpose: returns the section of the sub folder with the passed item ID or nullptr if the sub folder
+    //          has no section (binary search in the children of the parent). Only valid when the container has a section tree.
+    [[nodiscard]] const VVVSectionRecord* FindChildSection(const VVVSectionRecord& parent, uint32_t itemId) const noexcept
+    {
+        const auto& childIndex = GetSectionChildIndex(GetSectionIndex(parent));
+        const VVVSectionChild* first = GetChildTable() + childIndex.firstChild;
+        const VVVSectionChild* last = first + childIndex.childCount;
+        const auto* child = std::lower_bound(first, last, itemId,
+                                             [](const VVVSectionChild& value, uint32_t id) { return value.itemId < id; });
+        return child != last && child->itemId == itemId ? &GetSection(child->section) : nullptr;
+    }
+
+    [[nodiscard]] const VVVItemRecord* GetItems(const VVVSectionRecord& section) const noexcept
+    {
+        return GetItemTable() + section.firstItem;
+    }
+
+    // Purpose: version 3 containers store the slots of the active folders of every section.
+    [[nodiscard]] bool HasFolderIndex() const noexcept
+    {
+        return m_folderIndex.folderSlotTableOffset != 0;
+    }
+
+    // Purpose: returns the slots of the active folder items of a section, in ascending order.
+    //          Only valid when the container has a folder index.
+    [[nodiscard]] const uint32_t* GetFolderSlots(const VVVSectionRecord& section, uint32_t& count) const noexcept
+    {
+        const auto& folderIndex = GetSectionFolderIndex(GetSectionIndex(section));
+        count = folderIndex.folderCount;
+        return GetFolderSlotTable() + folderIndex.firstFolderSlot;
+    }
+
+    [[nodiscard]] std::u16string_view GetString(VVVStringRef ref) const noexcept
+    {
+        return {reinterpret_cast<const char16_t*>(m_data + m_header.stringPoolOffset + ref.offset), ref.length};
+    }
+
+    [[nodiscard]] std::u16string_view GetName(const VVVItemRecord& item) const noexcept
+    {
+        return GetString({item.nameOffset, item.nameLength});
+    }
+
+private:
+    static void CheckRange(uint64_t offset, uint64_t length, size_t size)
+    {
+        // Note: offsets must be 4 byte aligned to allow direct access to the records.
+        if (offset % 4 != 0 || offset + length > size)
+            throw std::invalid_argument("corrupt vvv container");
+    }
+
+    void CheckString(VVVStringRef ref) const
+    {
+        if (ref.offset % sizeof(char16_t) != 0 ||
+            uint64_t{ref.offset} + (uint64_t{ref.length} * sizeof(char16_t)) > m_header.stringPoolSize)
+            throw std::invalid_argument("corrupt vvv container");
+    }
+
+    [[nodiscard]] const VVVItemRecord* GetItemTable() const noexcept
+    {
+        return reinterpret_cast<const VVVItemRecord*>(m_data + m_header.itemTableOffset);
+    }
+
+    [[nodiscard]] const VVVSectionFolderIndex& GetSectionFolderIndex(uint32_t index) const noexcept
+    {
+        return reinterpret_cast<const VVVSectionFolderIndex*>(m_data + m_folderIndex.sectionFolderIndexOffset)[index];
+    }
+
+    [[nodiscard]] const uint32_t* GetFolderSlotTable() const noexcept
+    {
+        return reinterpret_cast<const uint32_t*>(m_data + m_folderIndex.folderSlotTableOffset);
+    }
+
+    void LoadFolderIndex(size_t size)
+    {
+        if (m_header.headerSize < sizeof m_header + sizeof m_folderIndex)
+            throw std::invalid_argument("corrupt vvv container");
+
+        CheckRange(sizeof m_header, sizeof m_folderIndex, size);
+        std::memcpy(&m_folderIndex, m_data + sizeof m_header, sizeof m_folderIndex);
+        CheckRange(m_folderIndex.sectionFolderIndexOffset, uint64_t{m_header.sectionCount} * sizeof(VVVSectionFolderIndex), size);
+        CheckRange(m_folderIndex.folderSlotTableOffset, uint64_t{m_folderIndex.folderSlotCount} * sizeof(uint32_t), size);
+        if (m_folderIndex.folderSlotTableOffset == 0)
+            throw std::invalid_argument("corrupt vvv container");
+
+        for (uint32_t i = 0; i < m_header.sectionCount; ++i)
+        {
+            const auto& folderIndex = GetSectionFolderIndex(i);
+            if (uint64_t{folderIndex.firstFolderSlot} + folderIndex.folderCount > m_folderIndex.folderSlotCount)
+                throw std::invalid_argument("corrupt vvv container");
+
+            const uint32_t itemCount = GetSection(i).itemCount;
+            const uint32_t* slots = GetFolderSlotTable() + folderIndex.firstFolderSlot;
+            for (uint32_t j = 0; j < folderIndex.folderCount; ++j)
+            {
+                if (slots[j] >= itemCount)
+                    throw std::invalid_argument("corrupt vvv container");
+            }
+        }
+    }
+
+    [[nodiscard]] const VVVSectionChildIndex& GetSectionChildIndex(uint32_t index) const noexcept
+    {
+        return reinterpret_cast<const VVVSectionChildIndex*>(m_data + m_sectionTree.sectionChildIndexOffset)[index];
+    }
+
+    [[nodiscard]] const VVVSectionChild* GetChildTable() const noexcept
+    {
+        return reinterpret_cast<const VVVSectionChild*>(m_data + m_sectionTree.childTableOffset);
+    }
+
+    void LoadSectionTree(size_t size)
+    {
+        constexpr size_t offset = sizeof(VVVContainerHeader) + sizeof(VVVFolderIndexHeader);
+        if (m_header.headerSize < offset + sizeof m_sectionTree)
+            throw std::invalid_argument("corrupt vvv container");
+
+        CheckRange(offset, sizeof m_sectionTree, size);
+        std::memcpy(&m_sectionTree, m_data + offset, sizeof m_sectionTree);
+        CheckRange(m_sectionTree.sectionChildIndexOffset, uint64_t{m_header.sectionCount} * sizeof(VVVSectionChildIndex), size);
+        CheckRange(m_sectionTree.childTableOffset, uint64_t{m_sectionTree.childCount} * sizeof(VVVSectionChild), size);
+        if (m_sectionTree.childTableOffset == 0)
+            throw std::invalid_argument("corrupt vvv container");
+
+        for (uint32_t i = 0; i < m_header.sectionCount; ++i)
+        {
+            const auto& childIndex = GetSectionChildIndex(i);
+            if (uint64_t{childIndex.firstChild} + childIndex.childCount > m_sectionTree.childCount)
+                throw std::invalid_argument("corrupt vvv container");
+
+            const VVVSectionChild* children = GetChildTable() + childIndex.firstChild;
+            for (uint32_t j = 0; j < childIndex.childCount; ++j)
+            {
+                if (children[j].section >= m_header.sectionCount || (j > 0 && !(children[j - 1].itemId < children[j].itemId)))
+                    throw std::invalid_argument("corrupt vvv container");
+            }
+        }
+    }
+
+    const std::byte* m_data{};
+    VVVContainerHeader m_header{};
+    VVVFolderIndexHeader m_folderIndex{};
+    VVVSectionTreeHeader m_sectionTree{};
+};
+
+
+struct VVVContainerItem
+{
+    std::u16string name;
+    uint32_t size{};
+    bool active{};
+    bool folder{};
+};
+
+
+struct VVVContainerSection
+{
+    std::u16string label;
+    uint32_t fileCount{};
+    std::vector<VVVContainerItem> items; // index = item slot.
+    uint32_t firstFreeSlot{};            // all slots before firstFreeSlot are active, 0 is always valid.
+
+    // Purpose: returns the lowest free slot and marks it active. Reusing the lowest free slot keeps
+    //          the allocation order stable. The hint only moves forward, which makes a series of
+    //          allocations O(1) amortized.
+    uint32_t AllocateSlot()
+    {
+        while (firstFreeSlot < items.size() && items[firstFreeSlot].active)
+        {
+            ++firstFreeSlot;
+        }
+
+        const uint32_t slot = firstFreeSlot;
+        if (slot == items.size())
+        {
+            items.emplace_back();
+        }
+
+        items[slot].active = true;
+        ++firstFreeSlot;
+        return slot;
+    }
+
+    void ReleaseSlot(uint32_t slot) noexcept
+    {
+        items[slot].active = false;
+        if (slot < firstFreeSlot)
+        {
+            firstFreeSlot = slot;
+        }
+    }
+};
+
+
+// Purpose: editable in-memory representation of a container. Used to create and update containers
+//          and to convert the original .ini based format.
+class VVVContainerModel final
+{
+public:
+    // Purpose: a model always contains the root section.
+    VVVContainerModel()
+    {
+        GetSection(std::u16string_view());
+    }
+
+    [[nodiscard]] static VVVContainerModel Load(const VVVContainerView& view)
+    {
+        VVVContainerModel model;
+
+        for (uint32_t i = 0; i < view.GetSectionCount(); ++i)
+        {
+            const auto& sectionRecord = view.GetSection(i);
+            auto& section = model.GetSection(view.GetString(sectionRecord.path));
+            section.label = view.GetString(sectionRecord.label);
+            section.fileCount = sectionRecord.fileCount;
+            section.firstFreeSlot = sectionRecord.firstFreeSlot;
+
+            const VVVItemRecord* items = view.GetItems(sectionRecord);
+            section.items.reserve(sectionRecord.itemCount);
+            for (uint32_t j = 0; j < sectionRecord.itemCount; ++j)
+            {
+                section.items.push_back({std::u16string(view.GetName(items[j])), items[j].size, items[j].IsActive(), items[j].IsFolder()});
+            }
+        }
+
+        return model;
+    }
+
+    // Purpose: converts the original .ini based format. All information that was visible
+    //          through the .ini format is preserved. Missing item slots become inactive items.
+    [[nodiscard]] static VVVContainerModel LoadFromIni(std::u16string_view text)
+    {
+        VVVContainerModel model;
+        VVVContainerSection* section{};
+        VVVContainerItem* item{};
+
+        while (!text.empty())
+        {
+            const size_t end = text.find_first_of(u"\r\n");
+            const auto line = Trim(text.substr(0, end));
+            text.remove_prefix(end == std::u16string_view::npos ? text.size() : end + 1);
+
+            if (line.empty() || line[0] == u';')
+                continue;
+
+            if (line[0] == u'[')
+            {
+                section = nullptr;
+                item = nullptr;
+
+                const auto name = Trim(line.substr(1, line.find(u']') - 1));
+                const size_t separator = name.rfind(u'\\');
+                const auto path = separator == std::u16string_view::npos ? std::u16string_view() : name.substr(0, separator);
+                const auto leaf = ToLower(name.substr(separator == std::u16string_view::npos ? 0 : separator + 1));
+
+                if (leaf == u"directory")
+                {
+                    section = &model.GetSection(path);
+                }
+                else if (leaf.size() > 4 && leaf.size() <= 4 + MaxSlotDigits && leaf.compare(0, 4, u"file") == 0 &&
+                         leaf.find_first_not_of(u"0123456789", 4) == std::u16string::npos)
+                {
+                    section = &model.GetSection(path);
+                    const auto slot = ToUInt(std::u16string_view(leaf).substr(4));
+                    if (section->items.size() <= slot)
+                    {
+                        section->items.resize(size_t{slot} + 1);
+                    }
+
+                    item = &section->items[slot];
+                }
+
+                continue;
+            }
+
+            const size_t equal = line.find(u'=');
+            if (equal == std::u16string_view::npos)
+                continue;
+
+            const auto key = ToLower(Trim(line.substr(0, equal)));
+            const auto value = Unquote(Trim(line.substr(equal + 1)));
+            if (item)
+            {
+                if (key == u"name")
+                {
+                    item->name = value;
+                }
+                else if (key == u"size")
+                {
+                    item->size = ToUInt(value);
+                }
+                else if (key == u"active")
+                {
+                    item->active = ToUInt(value) == 1;
+                }
+                else if (key == u"folder")
+                {
+                    item->folder = ToUInt(value) == 1;
+                }
+            }
+            else if (section)
+            {
+                if (key == u"label")
+                {
+                    section->label = value;
+                }
+                else if (key == u"filecount")
+                {
+                    section->fileCount = ToUInt(value);
+                }
+            }
+        }
+
+        return model;
+    }
+
+    // Purpose: returns the section of a folder, the section is created when it doesn't exist.
+    //          The sections of the parent folders are also created, every section is reachable from the root.
+    VVVContainerSection& GetSection(std::u16string_view path)
+    {
+        const auto it = m_sections.find(path);
+        if (it != m_sections.end())
+            return it->second;
+
+        if (!path.empty())
+        {
+            const size_t separator = path.rfind(u'\\');
+            GetSection(separator == std::u16string_view::npos ? std::u16string_view() : path.substr(0, separator));
+        }
+
+        return m_sections.emplace(std::u16string(path), VVVContainerSection()).first->second;
+    }
+
+    [[nodiscard]] const VVVContainerSection* FindSection(std::u16string_view path) const
+    {
+        const auto it = m_sections.find(path);
+        return it == m_sections.end() ? nullptr : &it->second;
+    }
+
+    [[nodiscard]] std::vector<std::byte> Serialize() const
+    {
+        uint64_t itemCount = 0;
+        uint64_t folderSlotCount = 0;
+        uint64_t stringPoolSize = 0;
+        for (const auto& [path, section] : m_sections)
+        {
+            itemCount += section.items.size();
+            stringPoolSize += (path.size() + section.label.size()) * sizeof(char16_t);
+            for (const auto& item : section.items)
+            {
+                if (item.name.size() > UINT16_MAX)
+                    throw std::length_error("vvv item name too long");
+
+                stringPoolSize += item.name.size() * sizeof(char16_t);
+                folderSlotCount += item.active && item.folder ? 1 : 0;
+            }
+        }
+
+        const auto children = CreateSectionTree();
+        uint64_t childCount = 0;
+        for (const auto& sectionChildren : children)
+        {
+            childCount += sectionChildren.size();
+        }
+
+        const uint64_t sectionCount = m_sections.size();
+        const uint64_t sectionTableOffset = sizeof(VVVContainerHeader) + sizeof(VVVFolderIndexHeader) + sizeof(VVVSectionTreeHeader);
+        const uint64_t sectionFolderIndexOffset = sectionTableOffset + (sectionCount * sizeof(VVVSectionRecord));
+        const uint64_t sectionChildIndexOffset = sectionFolderIndexOffset + (sectionCount * sizeof(VVVSectionFolderIndex));
+        const uint64_t itemTableOffset = sectionChildIndexOffset + (sectionCount * sizeof(VVVSectionChildIndex));
+        const uint64_t folderSlotTableOffset = itemTableOffset + (itemCount * sizeof(VVVItemRecord));
+        const uint64_t childTableOffset = folderSlotTableOffset + (folderSlotCount * sizeof(uint32_t));
+        const uint64_t stringPoolOffset = childTableOffset + (childCount * sizeof(VVVSectionChild));
+        if (stringPoolOffset + stringPoolSize > UINT32_MAX)
+            throw std::length_error("vvv container too large");
+
+        VVVContainerHeader header{};
+        header.signature = VVVContainerSignature;
+        header.version = VVVContainerVersion;
+        header.headerSize = sizeof(VVVContainerHeader) + sizeof(VVVFolderIndexHeader) + sizeof(VVVSectionTreeHeader);
+        header.sectionCount = static_cast<uint32_t>(sectionCount);
+        header.sectionTableOffset = static_cast<uint32_t>(sectionTableOffset);
+        header.itemCount = static_cast<uint32_t>(itemCount);
+        header.itemTableOffset = static_cast<uint32_t>(itemTableOffset);
+        header.stringPoolOffset = static_cast<uint32_t>(stringPoolOffset);
+        header.stringPoolSize = static_cast<uint32_t>(stringPoolSize);
+
+        VVVFolderIndexHeader folderIndexHeader{};
+        folderIndexHeader.sectionFolderIndexOffset = static_cast<uint32_t>(sectionFolderIndexOffset);
+        folderIndexHeader.folderSlotTableOffset = static_cast<uint32_t>(folderSlotTableOffset);
+        folderIndexHeader.folderSlotCount = static_cast<uint32_t>(folderSlotCount);
+
+        VVVSectionTreeHeader sectionTreeHeader{};
+        sectionTreeHeader.sectionChildIndexOffset = static_cast<uint32_t>(sectionChildIndexOffset);
+        sectionTreeHeader.childTableOffset = static_cast<uint32_t>(childTableOffset);
+        sectionTreeHeader.childCount = static_cast<uint32_t>(childCount);
+
+        std::vector<std::byte> buffer(header.stringPoolOffset + header.stringPoolSize);
+        std::memcpy(buffer.data(), &header, sizeof header);
+        std::memcpy(buffer.data() + sizeof header, &folderIndexHeader, sizeof folderIndexHeader);
+        std::memcpy(buffer.data() + sizeof header + sizeof folderIndexHeader, &sectionTreeHeader, sizeof sectionTreeHeader);
+
+        uint32_t stringOffset = 0;
+        auto addString = [&](std::u16string_view value) {
+            const VVVStringRef ref{stringOffset, static_cast<uint32_t>(value.size())};
+            std::memcpy(buffer.data() + header.stringPoolOffset + stringOffset, value.data(), value.size() * sizeof(char16_t));
+            stringOffset += static_cast<uint32_t>(value.size() * sizeof(char16_t));
+            return ref;
+        };
+
+        uint32_t sectionIndex = 0;
+        uint32_t firstItem = 0;
+        uint32_t folderSlotIndex = 0;
+        uint32_t childIndex = 0;
+        for (const auto& [path, section] : m_sections)
+        {
+            const VVVSectionChildIndex sectionChildIndex{childIndex, static_cast<uint32_t>(children[sectionIndex].size())};
+            std::memcpy(buffer.data() + sectionTreeHeader.sectionChildIndexOffset + (sectionIndex * sizeof(VVVSectionChildIndex)),
+                        &sectionChildIndex, sizeof sectionChildIndex);
+            if (!children[sectionIndex].empty())
+            {
+                std::memcpy(buffer.data() + sectionTreeHeader.childTableOffset + (size_t{childIndex} * sizeof(VVVSectionChild)),
+                            children[sectionIndex].data(), children[sectionIndex].size() * sizeof(VVVSectionChild));
+                childIndex += sectionChildIndex.childCount;
+            }
+
+            VVVSectionFolderIndex sectionFolderIndex{folderSlotIndex, 0};
+            VVVSectionRecord sectionRecord{};
+            sectionRecord.path = addString(path);
+            sectionRecord.label = addString(section.label);
+            sectionRecord.fileCount = section.fileCount;
+            sectionRecord.firstItem = firstItem;
+            sectionRecord.itemCount = static_cast<uint32_t>(section.items.size());
+            sectionRecord.firstFreeSlot = section.firstFreeSlot;
+            std::memcpy(buffer.data() + header.sectionTableOffset + (sectionIndex * sizeof(VVVSectionRecord)), &sectionRecord, sizeof sectionRecord);
+
+            for (uint32_t slot = 0; slot < section.items.size(); ++slot)
+            {
+                const auto& item = section.items[slot];
+                if (item.active && item.folder)
+                {
+                    std::memcpy(buffer.data() + folderIndexHeader.folderSlotTableOffset + (size_t{folderSlotIndex} * sizeof(uint32_t)), &slot, sizeof slot);
+                    ++folderSlotIndex;
+                    ++sectionFolderIndex.folderCount;
+                }
+
+                VVVItemRecord itemRecord{};
+                itemRecord.size = item.size;
+                const auto name = addString(item.name);
+                itemRecord.nameOffset = name.offset;
+                itemRecord.nameLength = static_cast<uint16_t>(name.length);
+                itemRecord.flags = static_cast<uint8_t>((item.active ? VVVItemFlagActive : 0) | (item.folder ? VVVItemFlagFolder : 0));
+                std::memcpy(buffer.data() + header.itemTableOffset + (size_t{firstItem} * sizeof(VVVItemRecord)), &itemRecord, sizeof itemRecord);
+                ++firstItem;
+            }
+
+            std::memcpy(buffer.data() + folderIndexHeader.sectionFolderIndexOffset + (sectionIndex * sizeof(VVVSectionFolderIndex)),
+                        &sectionFolderIndex, sizeof sectionFolderIndex);
+            ++sectionIndex;
+        }
+
+        return buffer;
+    }
+
+private:
+    static constexpr size_t MaxSlotDigits = 7;
+
+    // Purpose: returns per section (in path order) its child sections, sorted by item ID.
+    //          Sections with a last path element that is not a canonical item ID cannot be reached by an item and are not linked.
+    [[nodiscard]] std::vector<std::vector<VVVSectionChild>> CreateSectionTree() const
+    {
+        std::unordered_map<std::u16string_view, uint32_t> sectionIndices;
+        sectionIndices.reserve(m_sections.size());
+        for (const auto& [path, section] : m_sections)
+        {
+            sectionIndices.emplace(path, static_cast<uint32_t>(sectionIndices.size()));
+        }
+
+        std::vector<std::vector<VVVSectionChild>> children(m_sections.size());
+        for (const auto& [path, section] : m_sections)
+        {
+            if (path.empty())
+                continue;
+
+            const size_t separator = path.rfind(u'\\');
+            const std::u16string_view parentPath = separator == std::u16string::npos ? std::u16string_view() : std::u16string_view(path).substr(0, separator);
+            const std::u16string_view leaf = std::u16string_view(path).substr(separator == std::u16string::npos ? 0 : separator + 1);
+            uint32_t itemId;
+            const auto parent = sectionIndices.find(parentPath);
+            if (parent == sectionIndices.end() || !TryParseItemId(leaf, itemId))
+                continue;
+
+            children[parent->second].push_back({itemId, sectionIndices[path]});
+        }
+
+        for (auto& sectionChildren : children)
+        {
+            std::sort(sectionChildren.begin(), sectionChildren.end(),
+                      [](const VVVSectionChild& a, const VVVSectionChild& b) { return a.itemId < b.itemId; });
+        }
+
+        return children;
+    }
+
+    // Purpose: accepts only the decimal notation that is used to build paths (no leading zeros).
+    static bool TryParseItemId(std::u16string_view value, uint32_t& itemId) noexcept
+    {
+        if (value.empty() || value.size() > 9 || (value.size() > 1 && value[0] == u'0') ||
+            value.find_first_not_of(u"0123456789") != std::u16string_view::npos)
+            return false;
+
+        itemId = ToUInt(value);
+        return true;
+    }
+
+    static std::u16string_view Trim(std::u16string_view value) noexcept
+    {
+        const size_t first = value.find_first_not_of(u" \t");
+        if (first == std::u16string_view::npos)
+            return {};
+
+        return value.substr(first, value.find_last_not_of(u" \t") - first + 1);
+    }
+
+    static std::u16string_view Unquote(std::u16string_view value) noexcept
+    {
+        if (value.size() >= 2 && value.front() == u'"' && value.back() == u'"')
+            return value.substr(1, value.size() - 2);
+
+        return value;
+    }
+
+    static std::u16string ToLower(std::u16string_view value)
+    {
+        std::u16string result(value);
+        for (auto& c : result)
+        {
+            if (c >= u'A' && c <= u'Z')
+            {
+                c = static_cast<char16_t>(c - u'A' + u'a');
+            }
+        }
+
+        return result;
+    }
+
+    // Purpose: same behavior as GetPrivateProfileInt: converts the leading digits, stops at the first non digit.
+    static uint32_t ToUInt(std::u16string_view value) noexcept
+    {
+        uint32_t result = 0;
+        for (const auto c : value)
+        {
+            if (c < u'0' || c > u'9')
+                break;
+
+            result = (result * 10) + static_cast<uint32_t>(c - u'0');
+        }
+
+        return result;
+    }
+
+    std::map<std::u16string, VVVContainerSection, std::less<>> m_sections;
+};
@@ -8,39 +8,278 @@
 
 #include "vvv_file.h"
 
+#include <atlfile.h>
 #include <filesystem>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 using std::wstring;
 namespace fs = std::filesystem;
 
-const wchar_t* TSZ_APP_NAME_DIRECTORY = L"directory";
-const wchar_t* TSZ_FILE_COUNT         = L"filecount";
-const wchar_t* TSZ_FILE_FORMAT        = L"file%d";
-const wchar_t* TSZ_LABEL              = L"label";
-const wchar_t* TSZ_NAME               = L"name";
-const wchar_t* TSZ_SIZE               = L"size";
-const wchar_t* TSZ_ACTIVE             = L"active";
-const wchar_t* TSZ_FOLDER             = L"folder";
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "container strings are UTF-16");
+
+namespace {
+
+std::u16string_view ToU16StringView(std::wstring_view value) noexcept
+{
+    return {reinterpret_cast<const char16_t*>(value.data()), value.size()};
+}
+
+std::wstring_view ToWStringView(std::u16string_view value) noexcept
+{
+    return {reinterpret_cast<const wchar_t*>(value.data()), value.size()};
+}
+
+// Purpose: .ini files are either UTF-16 (with BOM) or stored in the ANSI code page.
+std::u16string DecodeIniText(const std::byte* data, size_t size)
+{
+    if (size >= 2 && data[0] == std::byte{0xFF} && data[1] == std::byte{0xFE})
+        return std::u16string(reinterpret_cast<const char16_t*>(data + 2), (size - 2) / sizeof(char16_t));
+
+    std::u16string text;
+    if (size == 0)
+        return text;
+
+    const auto* source = reinterpret_cast<const char*>(data);
+    const int length = MultiByteToWideChar(CP_ACP, 0, source, static_cast<int>(size), nullptr, 0);
+    msf::RaiseLastErrorExceptionIf(length == 0);
+    text.resize(static_cast<size_t>(length));
+    msf::RaiseLastErrorExceptionIf(
+        MultiByteToWideChar(CP_ACP, 0, source, static_cast<int>(size), reinterpret_cast<wchar_t*>(text.data()), length) == 0);
+    return text;
+}
+
+} // namespace
+
+
+// Purpose: read access to the content of a .vvv file. The content is read into private memory and
+//          the file is closed directly after the load: a cached or shared container never blocks the
+//          replace of the file by VVVFile::Save (also not when other processes have the folder open).
+//          Files in the original .ini format are converted in memory, the first update will save them
+//          in the binary format.
+class VVVFile::Container final
+{
+public:
+    explicit Container(const wstring& filename)
+    {
+        m_buffer = ReadContent(filename);
+        if (!VVVContainerView::IsContainer(m_buffer.data(), m_buffer.size()))
+        {
+            m_buffer = VVVContainerModel::LoadFromIni(DecodeIniText(m_buffer.data(), m_buffer.size())).Serialize();
+        }
+
+        m_view = VVVContainerView(m_buffer.data(), m_buffer.size());
+    }
+
+    [[nodiscard]] const VVVContainerView& GetView() const noexcept
+    {
+        return m_view;
+    }
+
+    // Purpose: the number of bytes of the container (read or converted).
+    [[nodiscard]] size_t GetSize() const noexcept
+    {
+        return m_buffer.size();
+    }
+
+private:
+    static std::vector<std::byte> ReadContent(const wstring& filename)
+    {
+        ATL::CAtlFile file;
+        msf::RaiseExceptionIfFailed(file.Create(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, OPEN_EXISTING));
+
+        ULONGLONG fileSize;
+        msf::RaiseExceptionIfFailed(file.GetSize(fileSize));
+        msf::RaiseExceptionIf(fileSize > MAXDWORD, HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE));
+
+        std::vector<std::byte> buffer(static_cast<size_t>(fileSize));
+        DWORD bytesRead{};
+        if (!buffer.empty())
+        {
+            msf::RaiseExceptionIfFailed(file.Read(buffer.data(), static_cast<DWORD>(buffer.size()), bytesRead));
+        }
+
+        buffer.resize(bytesRead);
+        return buffer;
+    }
+
+    std::vector<std::byte> m_buffer;
+    VVVContainerView m_view;
+};
+
+
+// Purpose: process wide cache of parsed containers. Explorer binds the same folder many times per
+//          navigation and every bind creates new VVVFile instances, the cache makes that a file is only
+//          parsed once. All sub folders of a file share the same container.
+//          An entry is only used when the identity of the file (size + last write time) is unchanged,
+//          this makes changes made by other processes visible. Above the byte budget the least
+//          recently used entries are evicted.
+class VVVFile::ContainerCache final
+{
+public:
+    static ContainerCache& GetInstance()
+    {
+        static ContainerCache instance;
+        return instance;
+    }
+
+    ContainerCache(const ContainerCache&) = delete;
+    ContainerCache(ContainerCache&&) = delete;
+    ContainerCache& operator=(const ContainerCache&) = delete;
+    ContainerCache& operator=(ContainerCache&&) = delete;
+
+    [[nodiscard]] std::shared_ptr<const Container> Get(const wstring& filename)
+    {
+        const auto identity = GetFileIdentity(filename);
+
+        {
+            std::lock_guard lock(m_mutex);
+
+            if (const auto it = m_index.find(filename); it != m_index.end())
+            {
+                if (it->second->identity == identity)
+                {
+                    m_entries.splice(m_entries.begin(), m_entries, it->second);
+                    return it->second->container;
+                }
+
+                Remove(it);
+            }
+        }
+
+        // Note: the file is parsed outside the lock, parallel misses for the same file both parse it.
+        auto container = std::make_shared<const Container>(filename);
+
+        std::lock_guard lock(m_mutex);
+
+        if (const auto it = m_index.find(filename); it != m_index.end())
+        {
+            Remove(it);
+        }
+
+        m_entries.push_front({filename, identity, container});
+        try
+        {
+            m_index.emplace(filename, m_entries.begin());
+        }
+        catch (...)
+        {
+            m_entries.pop_front();
+            throw;
+        }
+
+        m_size += container->GetSize();
+        EvictLeastRecentlyUsed();
+
+        return container;
+    }
+
+    void Invalidate(const wstring& filename) noexcept
+    {
+        std::lock_guard lock(m_mutex);
+
+        if (const auto it = m_index.find(filename); it != m_index.end())
+        {
+            Remove(it);
+        }
+    }
+
+private:
+    static constexpr size_t ByteBudget = 64 * 1024 * 1024;
+
+    struct FileIdentity final
+    {
+        ULONGLONG size;
+        ULONGLONG lastWriteTime;
+
+        bool operator==(const FileIdentity& other) const noexcept
+        {
+            return size == other.size && lastWriteTime == other.lastWriteTime;
+        }
+    };
+
+    struct Entry final
+    {
+        wstring filename;
+        FileIdentity identity;
+        std::shared_ptr<const Container> container;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    ContainerCache() = default;
+    ~ContainerCache() = default;
+
+    static FileIdentity GetFileIdentity(const wstring& filename)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        msf::RaiseLastErrorExceptionIf(!GetFileAttributesEx(filename.c_str(), GetFileExInfoStandard, &data));
+
+        return {(static_cast<ULONGLONG>(data.nFileSizeHigh) << 32) | data.nFileSizeLow,
+                (static_cast<ULONGLONG>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime};
+    }
+
+    void Remove(std::unordered_map<wstring, EntryList::iterator>::iterator it) noexcept
+    {
+        m_size -= it->second->container->GetSize();
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    // Note: the most recently used entry is always kept, even when it is larger than the budget.
+    void EvictLeastRecentlyUsed() noexcept
+    {
+        while (m_size > ByteBudget && m_entries.size() > 1)
+        {
+            Remove(m_index.find(m_entries.back().filename));
+        }
+    }
+
+    std::mutex m_mutex;
+    EntryList m_entries; // most recently used first.
+    std::unordered_map<wstring, EntryList::iterator> m_index;
+    size_t m_size{};
+};
+
+
+VVVSectionHandle::VVVSectionHandle(std::vector<unsigned int> itemIds) :
+    m_itemIds{std::move(itemIds)}
+{
+    for (const auto itemId : m_itemIds)
+    {
+        if (!m_path.empty())
+        {
+            m_path += L"\\";
+        }
+
+        m_path += std::to_wstring(itemId);
+    }
+}
+
+
+VVVFile::~VVVFile() = default;
 
 
 std::wstring VVVFile::GetLabel() const
 {
-    return GetPrivateProfileString(GetAppNameDirectory().c_str(), TSZ_LABEL);
+    const auto* section = GetSection();
+    return section ? wstring(ToWStringView(GetView().GetString(section->label))) : wstring();
 }
 
 
 void VVVFile::SetLabel(const std::wstring& label) const
 {
-    WritePrivateProfileString(GetAppNameDirectory().c_str(), TSZ_LABEL, label.c_str());
+    Transaction transaction(*this);
+    transaction.SetLabel(label);
+    transaction.Commit();
 }
 
 
 unsigned int VVVFile::GetFileCount() const
 {
-    const auto nCount = GetPrivateProfileInt(TSZ_APP_NAME_DIRECTORY, TSZ_FILE_COUNT);
-    msf::RaiseExceptionIf(nCount == static_cast<uint32_t>(-1));
-
-    return nCount;
+    const auto* section = GetSection();
+    return section ? section->fileCount : 0;
 }
 
 
@@ -51,161 +290,261 @@ unsigned int VVVFile::GetFileCount() const
 //          to get a new index.
 LPITEMIDLIST VVVFile::GetNextItem(DWORD grfFlags, unsigned int& nItemIterator) const
 {
-    for (;;)
-    {
-        auto strAppName = GetAppNameItem(nItemIterator);
+    const auto* section = GetSection();
+    if (!section)
+        return nullptr;
 
-        const auto nActive = static_cast<int>(GetPrivateProfileInt(strAppName.c_str(), TSZ_ACTIVE, -1));
-        if (nActive == -1)
+    const auto& view = GetView();
+    const VVVItemRecord* items = view.GetItems(*section);
+    if (!msf::IsBitSet(grfFlags, SHCONTF_NONFOLDERS) && view.HasFolderIndex())
+    {
+        // Folders only (navigation pane): the iterator is the position in the folder index.
+        uint32_t folderCount;
+        const uint32_t* folderSlots = view.GetFolderSlots(*section, folderCount);
+        if (!msf::IsBitSet(grfFlags, SHCONTF_FOLDERS) || nItemIterator >= folderCount)
             return nullptr;
 
+        const uint32_t slot = folderSlots[nItemIterator];
         ++nItemIterator;
+        const auto& item = items[slot];
+        return VVVItem::CreateItemIdList(GetItemId(slot), item.size, true, ToWStringView(view.GetName(item)));
+    }
 
-        if (nActive == 1)
-        {
-            const auto folder = GetPrivateProfileInt(strAppName.c_str(), TSZ_FOLDER) == 1;
-
-            if ((msf::IsBitSet(grfFlags, SHCONTF_NONFOLDERS) && !folder) ||
-                (msf::IsBitSet(grfFlags, SHCONTF_FOLDERS) && folder))
-            {
-                const auto size = GetPrivateProfileInt(strAppName.c_str(), TSZ_SIZE);
-                msf::RaiseExceptionIf(size == static_cast<uint32_t>(-1));
-                const auto strName = GetPrivateProfileString(strAppName.c_str(), TSZ_NAME);
+    while (nItemIterator < section->itemCount)
+    {
+        const uint32_t slot = nItemIterator;
+        const auto& item = items[slot];
+        ++nItemIterator;
 
-                return VVVItem::CreateItemIdList(nItemIterator, size, folder, strName);
-            }
+        if (item.IsActive() &&
+            ((msf::IsBitSet(grfFlags, SHCONTF_NONFOLDERS) && !item.IsFolder()) ||
+             (msf::IsBitSet(grfFlags, SHCONTF_FOLDERS) && item.IsFolder())))
+        {
+            return VVVItem::CreateItemIdList(GetItemId(slot), item.size, item.IsFolder(), ToWStringView(view.GetName(item)));
         }
     }
+
+    return nullptr;
 }
 
 
 void VVVFile::DeleteItems(const std::vector<VVVItem>& items) const
 {
-    for (auto item : items)
-    {
-        DeleteItem(item);
-    }
-
-    SetFileCount(GetFileCount() - static_cast<unsigned int>(items.size()));
-
-    // Note: due to .ini file implementation, inactive items will stay in .ini file.
+    Transaction transaction(*this);
+    transaction.DeleteItems(items);
+    transaction.Commit();
 }
 
 
 void VVVFile::SetItem(const VVVItem& item) const
 {
-    const auto strAppNameItem = GetAppNameItem(item.GetID());
-
-    WritePrivateProfileString(strAppNameItem.c_str(), TSZ_NAME, item.GetName().c_str());
-    WritePrivateProfileInt(strAppNameItem.c_str(), TSZ_SIZE, item.GetSize());
+    Transaction transaction(*this);
+    transaction.SetItem(item);
+    transaction.Commit();
 }
 
 
 PUIDLIST_RELATIVE VVVFile::AddItem(const std::wstring& strFile) const
 {
-    const std::wstring strName(PathFindFileName(strFile.c_str()));
-    return AddItem(static_cast<unsigned int>(fs::file_size(strFile)), strName);
+    Transaction transaction(*this);
+    msf::ItemIDList pidlItem(transaction.AddItem(strFile));
+    transaction.Commit();
+
+    return pidlItem.DetachRelative();
 }
 
 
 PUIDLIST_RELATIVE VVVFile::AddItem(unsigned int size, const std::wstring& name) const
 {
-    const auto nId = FindFreeEntry();
-
-    msf::ItemIDList pidlItem(VVVItem::CreateItemIdList(nId, size, false, name));
-    AddItem(VVVItem(pidlItem.GetRelative()));
+    Transaction transaction(*this);
+    msf::ItemIDList pidlItem(transaction.AddItem(size, name));
+    transaction.Commit();
 
     return pidlItem.DetachRelative();
 }
 
 
-void VVVFile::AddItem(const VVVItem& item) const
+// Purpose: returns the item of an item ID, an item can be added directly after the last slot.
+VVVContainerItem& VVVFile::GetItem(VVVContainerSection& section, unsigned int id)
 {
-    SetItem(item);
-    WritePrivateProfileInt(GetAppNameItem(item.GetID()).c_str(), TSZ_ACTIVE, 1);
-    SetFileCount(GetFileCount() + 1);
+    const uint32_t slot = GetSlot(id);
+    msf::RaiseExceptionIf(slot > section.items.size(), E_INVALIDARG);
+    if (slot == section.items.size())
+    {
+        section.items.emplace_back();
+    }
+
+    return section.items[slot];
+}
+
+
+// Purpose: converts an item ID to its slot. The ID of an item is its slot + 1 (see GetItemId).
+uint32_t VVVFile::GetSlot(unsigned int id)
+{
+    msf::RaiseExceptionIf(id == 0, E_INVALIDARG);
+    return id - 1;
 }
 
 
-void VVVFile::DeleteItem(const VVVItem& item) const
+std::u16string_view VVVFile::GetFolder() const noexcept
 {
-    const auto strAppNameItem = GetAppNameItem(item.GetID());
-    ATLASSERT(GetPrivateProfileInt(strAppNameItem.c_str(), TSZ_ACTIVE) == 1); // item was already deleted!
-    WritePrivateProfileInt(strAppNameItem.c_str(), TSZ_ACTIVE, 0);
+    return m_folder ? ToU16StringView(m_folder->GetPath()) : std::u16string_view();
 }
 
 
-unsigned int VVVFile::FindFreeEntry() const
+void VVVFile::InvalidateCache(const std::wstring& filename) noexcept
 {
-    for (unsigned int n = 0;; ++n)
+    ContainerCache::GetInstance().Invalidate(filename);
+}
+
+
+const VVVContainerView& VVVFile::GetView() const
+{
+    if (!m_container)
     {
-        auto strAppName = GetAppNameItem(n);
-        const auto nActive = GetPrivateProfileInt(strAppName.c_str(), TSZ_ACTIVE);
+        m_container = ContainerCache::GetInstance().Get(m_filename);
+    }
 
-        if (nActive != 1)
-            return n;
+    return m_container->GetView();
+}
+
+
+// Purpose: returns the section of the folder or nullptr when the folder has no section (yet).
+//          The section of a sub folder is only resolved again when the content of the file was changed.
+const VVVSectionRecord* VVVFile::GetSection() const
+{
+    const auto& view = GetView();
+    if (!m_folder)
+        return view.FindSection(std::u16string_view());
+
+    std::lock_guard lock(m_folder->m_mutex);
+    if (m_folder->m_container.lock() != m_container)
+    {
+        m_folder->m_section = ResolveSection(view, *m_folder);
+        m_folder->m_container = m_container;
     }
+
+    return m_folder->m_section;
 }
 
 
-void VVVFile::SetFileCount(unsigned int nNewFileCount) const
+// Purpose: walks the section tree, 1 lookup per level. Containers without a section tree
+//          (older versions) are searched by path.
+const VVVSectionRecord* VVVFile::ResolveSection(const VVVContainerView& view, const VVVSectionHandle& folder) noexcept
 {
-    return WritePrivateProfileInt(GetAppNameDirectory().c_str(), TSZ_FILE_COUNT, nNewFileCount);
+    if (!view.HasSectionTree())
+        return view.FindSection(ToU16StringView(folder.GetPath()));
+
+    const auto* section = view.FindSection(std::u16string_view());
+    for (const auto itemId : folder.GetItemIds())
+    {
+        if (!section)
+            break;
+
+        section = view.FindChildSection(*section, itemId);
+    }
+
+    return section;
+}
+
+
+VVVContainerModel VVVFile::LoadModel() const
+{
+    return VVVContainerModel::Load(GetView());
 }
 
 
-wstring VVVFile::GetAppNameDirectory() const
+// Purpose: the new content is written to a temporary file in the same directory, which then
+//          replaces the original in one step: readers see either the old or the new content.
+void VVVFile::Save(const VVVContainerModel& model) const
 {
-    wstring strAppName;
+    const auto buffer = model.Serialize();
 
-    if (m_folder.empty())
+    // The cached content is outdated after the replace (the containers themselves do not lock the file).
+    m_container.reset();
+    InvalidateCache(m_filename);
+
+    wchar_t tempFilename[MAX_PATH];
+    msf::RaiseLastErrorExceptionIf(!GetTempFileName(fs::path(m_filename).parent_path().c_str(), L"vvv", 0, tempFilename));
+
+    try
     {
-        strAppName = TSZ_APP_NAME_DIRECTORY;
+        ATL::CAtlFile file;
+        msf::RaiseExceptionIfFailed(file.Create(tempFilename, GENERIC_WRITE, 0, CREATE_ALWAYS));
+        msf::RaiseExceptionIfFailed(file.Write(buffer.data(), static_cast<DWORD>(buffer.size())));
+        msf::RaiseExceptionIfFailed(file.Flush());
+        file.Close();
+
+        msf::RaiseLastErrorExceptionIf(!MoveFileEx(tempFilename, m_filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+        InvalidateCache(m_filename); // a reader could have cached the old content while the new content was written.
     }
-    else
+    catch (...)
     {
-        strAppName = m_folder + L"\\" + TSZ_APP_NAME_DIRECTORY;
+        DeleteFile(tempFilename);
+        throw;
     }
+}
 
-    return strAppName;
+
+VVVFile::Transaction::Transaction(const VVVFile& file) :
+    m_file{file},
+    m_model{file.LoadModel()},
+    m_section{m_model.GetSection(file.GetFolder())}
+{
 }
 
 
-wstring VVVFile::GetAppNameItem(unsigned int id) const
+void VVVFile::Transaction::SetLabel(const std::wstring& label)
 {
-    ATL::CString strAppName;
-    strAppName.Format(TSZ_FILE_FORMAT, id);
+    m_section.label = ToU16StringView(label);
+}
+
 
-    if (!m_folder.empty())
+void VVVFile::Transaction::DeleteItems(const std::vector<VVVItem>& items)
+{
+    for (const auto& item : items)
     {
-        strAppName = m_folder.c_str() + ATL::CString(L"\\") + strAppName;
+        const uint32_t slot = GetSlot(item.GetID());
+        msf::RaiseExceptionIf(slot >= m_section.items.size(), E_INVALIDARG);
+        ATLASSERT(m_section.items[slot].active); // item was already deleted!
+        m_section.ReleaseSlot(slot);
     }
 
-    return strAppName.GetString();
+    // Note: inactive items stay in the file, this keeps the index of the other items stable.
+    m_section.fileCount -= static_cast<unsigned int>(items.size());
 }
 
 
-wstring VVVFile::GetPrivateProfileString(const wchar_t* lpAppName, const wchar_t* lpKeyName) const
+void VVVFile::Transaction::SetItem(const VVVItem& item)
 {
-    wchar_t tszBuf[255];
-    ::GetPrivateProfileString(lpAppName, lpKeyName, L"", tszBuf, 255, m_filename.c_str());
-    return tszBuf;
+    auto& containerItem = GetItem(m_section, item.GetID());
+
+    containerItem.name = ToU16StringView(item.GetName());
+    containerItem.size = item.GetSize();
 }
 
 
-unsigned int  VVVFile::GetPrivateProfileInt(const wchar_t* lpAppName, const wchar_t* lpKeyName, int nDefault) const noexcept
+PUIDLIST_RELATIVE VVVFile::Transaction::AddItem(const std::wstring& strFile)
 {
-    return ::GetPrivateProfileInt(lpAppName, lpKeyName, nDefault, m_filename.c_str());
+    const std::wstring strName(PathFindFileName(strFile.c_str()));
+    return AddItem(static_cast<unsigned int>(fs::file_size(strFile)), strName);
 }
 
 
-void VVVFile::WritePrivateProfileString(const wchar_t* lpAppName, const wchar_t* lpKeyName, const wchar_t* lpString) const
+PUIDLIST_RELATIVE VVVFile::Transaction::AddItem(unsigned int size, const std::wstring& name)
 {
-    msf::RaiseLastErrorExceptionIf(!::WritePrivateProfileString(lpAppName, lpKeyName, lpString, m_filename.c_str()));
+    const auto slot = m_section.AllocateSlot();
+
+    msf::ItemIDList pidlItem(VVVItem::CreateItemIdList(GetItemId(slot), size, false, name));
+
+    m_section.items[slot] = {std::u16string(ToU16StringView(name)), size, true, false};
+    ++m_section.fileCount;
+
+    return pidlItem.DetachRelative();
 }
 
 
-void VVVFile::WritePrivateProfileInt(const wchar_t* lpAppName, const wchar_t* lpKeyName, unsigned int nValue) const
+void VVVFile::Transaction::Commit() const
 {
-    WritePrivateProfileString(lpAppName, lpKeyName, std::to_wstring(nValue).c_str());
+    m_file.Save(m_model);
 }
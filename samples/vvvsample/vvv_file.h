@@ -6,16 +6,94 @@
 #pragma once
 
 #include "vvv_item.h"
+#include "vvv_container.h"
+
+#include <memory>
+#include <mutex>
+
+class VVVFile;
+
+
+// Purpose: identifies a sub folder of a .vvv file by the IDs of the folder items on its path.
+//          Created once when the shell binds to the sub folder and shared by all users of the folder.
+//          The section of the folder is resolved with 1 lookup per level and cached until the content of the file changes.
+class VVVSectionHandle final
+{
+public:
+    explicit VVVSectionHandle(std::vector<unsigned int> itemIds);
+
+    VVVSectionHandle(const VVVSectionHandle&) = delete;
+    VVVSectionHandle(VVVSectionHandle&&) = delete;
+    VVVSectionHandle& operator=(const VVVSectionHandle&) = delete;
+    VVVSectionHandle& operator=(VVVSectionHandle&&) = delete;
+    ~VVVSectionHandle() = default;
+
+    [[nodiscard]] const std::vector<unsigned int>& GetItemIds() const noexcept
+    {
+        return m_itemIds;
+    }
+
+    // Purpose: the path of the section (the '\' separated item IDs), used when the file is updated.
+    [[nodiscard]] const std::wstring& GetPath() const noexcept
+    {
+        return m_path;
+    }
+
+private:
+    friend class VVVFile;
+
+    std::vector<unsigned int> m_itemIds;
+    std::wstring m_path;
+    mutable std::mutex m_mutex;
+    mutable std::weak_ptr<const void> m_container; // the container that was used to resolve the section.
+    mutable const VVVSectionRecord* m_section{};
+};
+
 
 class VVVFile
 {
 public:
-    explicit VVVFile(std::wstring filename, std::wstring folder = std::wstring()) noexcept :
+    // Purpose: buffers a set of updates in memory and writes them in one atomic step.
+    //          Updates that are not committed are discarded.
+    class Transaction final
+    {
+    public:
+        explicit Transaction(const VVVFile& file);
+
+        Transaction(const Transaction&) = delete;
+        Transaction(Transaction&&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+        Transaction& operator=(Transaction&&) = delete;
+        ~Transaction() = default;
+
+        void SetLabel(const std::wstring& label);
+        void DeleteItems(const std::vector<VVVItem>& items);
+        void SetItem(const VVVItem& item);
+
+        PUIDLIST_RELATIVE AddItem(const std::wstring& file);
+        PUIDLIST_RELATIVE AddItem(unsigned int size, const std::wstring& name);
+
+        void Commit() const;
+
+    private:
+        const VVVFile& m_file;
+        VVVContainerModel m_model;
+        VVVContainerSection& m_section;
+    };
+
+    // Purpose: opens the root folder of the file, or the sub folder of the passed section handle.
+    explicit VVVFile(std::wstring filename, std::shared_ptr<const VVVSectionHandle> folder = {}) noexcept :
         m_filename{std::move(filename)},
         m_folder{std::move(folder)}
     {
     }
 
+    ~VVVFile();
+    VVVFile(const VVVFile&) = delete;
+    VVVFile(VVVFile&&) = delete;
+    VVVFile& operator=(const VVVFile&) = delete;
+    VVVFile& operator=(VVVFile&&) = delete;
+
     std::wstring GetLabel() const;
     void SetLabel(const std::wstring& label) const;
     unsigned int GetFileCount() const;
@@ -26,23 +104,31 @@ class VVVFile
     PUIDLIST_RELATIVE AddItem(const std::wstring& file) const;
     PUIDLIST_RELATIVE AddItem(unsigned int size, const std::wstring& name) const;
 
-private:
-    void AddItem(const VVVItem& item) const;
-    void DeleteItem(const VVVItem& item) const;
+    // Purpose: drops the cached parsed content of a file, the next access will parse the file again.
+    static void InvalidateCache(const std::wstring& filename) noexcept;
 
-    void SetFileCount(unsigned int newFileCount) const;
-    unsigned int FindFreeEntry() const;
+private:
+    class Container;
+    class ContainerCache;
 
-    std::wstring GetAppNameDirectory() const;
-    std::wstring GetAppNameItem(unsigned int id) const;
+    static VVVContainerItem& GetItem(VVVContainerSection& section, unsigned int id);
+    static uint32_t GetSlot(unsigned int id);
 
-    std::wstring GetPrivateProfileString(const wchar_t* appName, const wchar_t* keyName) const;
-    unsigned int GetPrivateProfileInt(const wchar_t* appName, const wchar_t* keyName, int defaultValue = -1) const noexcept;
+    // Purpose: the ID of an item is its slot + 1 (the PIDLs and sub folder paths use the ID).
+    [[nodiscard]] static unsigned int GetItemId(uint32_t slot) noexcept
+    {
+        return slot + 1;
+    }
 
-    void WritePrivateProfileString(const wchar_t* appName, const wchar_t* keyName, const wchar_t* value) const;
-    void WritePrivateProfileInt(const wchar_t* appName, const wchar_t* keyName, unsigned int value) const;
+    std::u16string_view GetFolder() const noexcept;
+    const VVVContainerView& GetView() const;
+    const VVVSectionRecord* GetSection() const;
+    static const VVVSectionRecord* ResolveSection(const VVVContainerView& view, const VVVSectionHandle& folder) noexcept;
+    VVVContainerModel LoadModel() const;
+    void Save(const VVVContainerModel& model) const;
 
     // Member variables
     std::wstring m_filename;
-    std::wstring m_folder;
+    std::shared_ptr<const VVVSectionHandle> m_folder;
+    mutable std::shared_ptr<const Container> m_container;
 };
@@ -84,6 +84,39 @@ int VVVItem::Compare(const VVVItem& item, int compareBy, bool /*bCanonicalOnly*/
 }
 
 
+// Purpose: the name column has a sort key, it is computed once and kept in this object.
+//          The key depends on the user locale and is therefore not stored in the PIDL.
+std::string_view VVVItem::GetSortKey(uint32_t column) const noexcept
+{
+    if (column != static_cast<uint32_t>(ColumnName))
+        return {};
+
+    if (m_nameSortKey.empty())
+    {
+        try
+        {
+            m_nameSortKey = CreateNameSortKey(GetID(), IsFolder(), GetNameView());
+        }
+        catch (...)
+        {
+            return {}; // the items are then compared with CompareByName.
+        }
+    }
+
+    return m_nameSortKey;
+}
+
+
+// Purpose: the size column can be sorted on the size itself (radix sort).
+std::optional<uint64_t> VVVItem::GetIntegerSortKey(uint32_t column) const noexcept
+{
+    if (column != static_cast<uint32_t>(ColumnSize))
+        return std::nullopt;
+
+    return GetSize();
+}
+
+
 wstring VVVItem::GetItemDetailsOf(uint32_t columnIndex) const
 {
     switch (columnIndex)
@@ -139,10 +172,41 @@ int VVVItem::CompareByName(const VVVItem& item) const noexcept
             return 1;
     }
 
-    const auto nResult = StrCmpW(GetItemData().name, item.GetItemData().name);
+    const auto nResult = StrCmpW(GetNameView().data(), item.GetNameView().data());
     if (nResult != 0)
         return nResult; // different by name
 
     // VVV items can be equal by name, but are always different by ID.
     return msf::UIntCmp(GetID(), item.GetID());
 }
+
+
+// Purpose: creates a sort key that results in the same order as CompareByName when compared byte-wise:
+//          folder/file, the collation sort key of the name and the ID (big-endian).
+std::string VVVItem::CreateNameSortKey(unsigned int id, bool folder, std::wstring_view name)
+{
+    std::string sortKey(1, folder ? '\0' : '\1');
+
+    if (name.empty())
+    {
+        sortKey.push_back('\0');
+    }
+    else
+    {
+        const int nameLength = static_cast<int>(name.size());
+        const int size = LCMapStringEx(LOCALE_NAME_USER_DEFAULT, LCMAP_SORTKEY, name.data(), nameLength, nullptr, 0, nullptr, nullptr, 0);
+        msf::RaiseLastErrorExceptionIf(size == 0);
+
+        // Note: the collation sort key includes a terminating zero, which separates it from the ID.
+        sortKey.resize(1 + static_cast<size_t>(size));
+        msf::RaiseLastErrorExceptionIf(LCMapStringEx(LOCALE_NAME_USER_DEFAULT, LCMAP_SORTKEY, name.data(), nameLength,
+                                                     reinterpret_cast<PWSTR>(sortKey.data() + 1), size, nullptr, nullptr, 0) == 0);
+    }
+
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        sortKey.push_back(static_cast<char>((id >> shift) & 0xFF));
+    }
+
+    return sortKey;
+}
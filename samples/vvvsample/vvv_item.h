@@ -15,12 +15,12 @@ class VVVItem final : public msf::ItemBase
         return 10; // note: limit is 10 for easy testing.
     }
 
-    static PUIDLIST_RELATIVE CreateItemIdList(unsigned int id, unsigned int size, bool folder, const std::wstring& name)
+    static PUIDLIST_RELATIVE CreateItemIdList(unsigned int id, unsigned int size, bool folder, std::wstring_view name)
     {
-        const PUIDLIST_RELATIVE pidl = msf::ItemIDList::CreateItemIdListWithTerminator(sizeof(SItemData));
+        msf::RaiseExceptionIf(name.size() >= MAX_PATH, E_INVALIDARG);
 
-        InitializeItemData(reinterpret_cast<SItemData*>(pidl->mkid.abID),
-            id, size, folder, name);
+        const PUIDLIST_RELATIVE pidl = msf::ItemIDList::CreateItemIdListWithTerminator(ItemSchema::GetSize(TypeID, folder, id, size, name));
+        ItemSchema::Write(pidl->mkid.abID, TypeID, folder, id, size, name);
 
         return pidl;
     }
@@ -29,11 +29,11 @@ class VVVItem final : public msf::ItemBase
     {
         // Shell item IDs can be passed from external sources, validate
         // It is valid to pass a PIDL that is larger then the original (done by Search functionality in XP).
-        const bool valid = GetDataSize() >= sizeof(SItemData) && GetItemData().nTypeID == TypeID;
+        const bool valid = IsValidItemData() || IsValidItemDataVersion3() || IsValidItemDataVersion1();
 #ifdef _DEBUG
         if (!valid)
         {
-            ATLTRACE(L"VVVItem::Constructor, PIDL not valid (data_size=%d, s_item_size=%d)\n", GetDataSize(), sizeof(SItemData));
+            ATLTRACE(L"VVVItem::Constructor, PIDL not valid (data_size=%d)\n", GetDataSize());
         }
 #endif
         msf::RaiseExceptionIf(!valid);
@@ -45,25 +45,36 @@ class VVVItem final : public msf::ItemBase
 
     [[nodiscard]] unsigned int GetID() const noexcept
     {
-        return GetItemData().id;
+        return GetField<IdField>();
     }
 
     [[nodiscard]] unsigned int GetSize() const noexcept
     {
-        return GetItemData().size;
+        return GetField<SizeField>();
     }
 
     [[nodiscard]] std::wstring GetName() const
     {
-        return GetItemData().name;
+        return std::wstring(GetNameView());
+    }
+
+    // Purpose: zero-copy access to the name, the name is always zero terminated.
+    [[nodiscard]] std::wstring_view GetNameView() const noexcept
+    {
+        if (GetTypeID() == TypeIDVersion1)
+            return static_cast<const SItemDataVersion1*>(GetData())->name;
+
+        return GetField<NameField>();
     }
 
     [[nodiscard]] bool IsFolder() const noexcept
     {
-        return GetItemData().folder;
+        return GetField<FolderField>();
     }
 
     [[nodiscard]] int Compare(const VVVItem& item, int compareBy, bool bCanonicalOnly) const noexcept;
+    [[nodiscard]] std::string_view GetSortKey(uint32_t column) const noexcept;
+    [[nodiscard]] std::optional<uint64_t> GetIntegerSortKey(uint32_t column) const noexcept;
     [[nodiscard]] std::wstring GetItemDetailsOf(uint32_t columnIndex) const;
     [[nodiscard]] std::wstring GetInfoTipText() const;
     [[nodiscard]] int GetIconOf(uint32_t flags) const noexcept;
@@ -72,11 +83,27 @@ class VVVItem final : public msf::ItemBase
 
     // By setting and checking for a TypeId (or cookie) we can ensure that the PIDL
     // was created by us. Using a version # will allows to handle older persisted PIDLs
-    constexpr static unsigned int TypeID = 0x5601; // 'V' + version #
-
-    // By using a struct with a version # it becomes possible to detected old persisted PIDLs.
+    // Note: new PIDLs are created with the version 2 layout, version 3 was a temporary extension of it.
+    constexpr static uint16_t TypeID = 0x5602; // 'V' + version #
+    constexpr static uint16_t TypeIDVersion3 = 0x5603;
+    constexpr static uint16_t TypeIDVersion1 = 0x5601;
+
+    // Version 2 layout: the name is stored directly after the fixed part.
+    using ItemSchema = msf::PidlSchema<uint16_t, bool, uint32_t, uint32_t, std::wstring_view>;
+    constexpr static size_t TypeIDField = 0;
+    constexpr static size_t FolderField = 1;
+    constexpr static size_t IdField = 2;
+    constexpr static size_t SizeField = 3;
+    constexpr static size_t NameField = 4;
+
+    // Version 3 layout (version 2 + a sort key of the name), still accepted to resolve persisted PIDLs.
+    // The stored sort key is ignored: it depends on the locale at the time the PIDL was created.
+    using ItemSchemaVersion3 = msf::PidlSchema<uint16_t, bool, uint32_t, uint32_t, std::wstring_view, std::string_view>;
+
+    // Version 1 layout (fixed size name), still accepted to resolve persisted PIDLs.
+    // Note: both versions share the same fixed part, which makes it possible to read it without a version check.
     #pragma pack(1) // By using an explicit pack the memory layout is better fixed then trusting the project settings.
-    struct SItemData
+    struct SItemDataVersion1
     {
         unsigned short nTypeID;
         bool         folder;
@@ -86,19 +113,51 @@ class VVVItem final : public msf::ItemBase
     };
     #pragma pack()
 
-    static void InitializeItemData(SItemData* itemData, unsigned int id, unsigned int size, bool folder, const std::wstring& name) noexcept
+    [[nodiscard]] ItemSchema::View GetItemData() const noexcept
+    {
+        return ItemSchema::View(GetData(), GetDataSize());
+    }
+
+    [[nodiscard]] ItemSchemaVersion3::View GetItemDataVersion3() const noexcept
+    {
+        return ItemSchemaVersion3::View(GetData(), GetDataSize());
+    }
+
+    [[nodiscard]] uint16_t GetTypeID() const noexcept
     {
-        itemData->nTypeID = TypeID;
-        itemData->id     = id;
-        itemData->folder = folder;
-        itemData->size   = size;
-        wcscpy_s(itemData->name, _countof(itemData->name), name.c_str());
+        return GetItemData().Get<TypeIDField>(); // the type ID is the first field in all versions.
     }
 
-    [[nodiscard]] const SItemData& GetItemData() const noexcept
+    // Purpose: reads a field with the layout of the PIDL version. The fields of version 2 precede the sort key
+    //          of version 3, but the name is stored at a different offset.
+    template<size_t Index>
+    [[nodiscard]] auto GetField() const noexcept
     {
-        return *static_cast<const SItemData*>(GetData());
+        if (GetTypeID() == TypeIDVersion3)
+            return GetItemDataVersion3().Get<Index>();
+
+        return GetItemData().Get<Index>();
+    }
+
+    [[nodiscard]] bool IsValidItemData() const noexcept
+    {
+        return ItemSchema::IsValid(GetData(), GetDataSize()) && GetTypeID() == TypeID &&
+               GetItemData().Get<NameField>().size() < MAX_PATH;
     }
 
+    [[nodiscard]] bool IsValidItemDataVersion3() const noexcept
+    {
+        return ItemSchemaVersion3::IsValid(GetData(), GetDataSize()) && GetTypeID() == TypeIDVersion3 &&
+               GetItemDataVersion3().Get<NameField>().size() < MAX_PATH;
+    }
+
+    [[nodiscard]] bool IsValidItemDataVersion1() const noexcept
+    {
+        return GetDataSize() >= sizeof(SItemDataVersion1) && GetTypeID() == TypeIDVersion1;
+    }
+
+    [[nodiscard]] static std::string CreateNameSortKey(unsigned int id, bool folder, std::wstring_view name);
     [[nodiscard]] int CompareByName(const VVVItem& item) const noexcept;
+
+    mutable std::string m_nameSortKey; // computed on demand, never persisted.
 };
@@ -0,0 +1,254 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/change_notify_batcher.h>
+
+#include <string_view>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+// Purpose: creates the bytes of a child PIDL with 1 SHITEMID.
+vector<std::byte> CreatePidl(string_view itemId)
+{
+    vector<std::byte> pidl;
+    const auto size = static_cast<uint16_t>(sizeof(uint16_t) + itemId.size());
+    pidl.push_back(static_cast<std::byte>(size & 0xFF));
+    pidl.push_back(static_cast<std::byte>(size >> 8));
+    for (const char c : itemId)
+    {
+        pidl.push_back(static_cast<std::byte>(c));
+    }
+
+    pidl.push_back(std::byte{});
+    pidl.push_back(std::byte{});
+    return pidl;
+}
+
+PCUIDLIST_RELATIVE AsPidl(const vector<std::byte>& pidl) noexcept
+{
+    return reinterpret_cast<PCUIDLIST_RELATIVE>(pidl.data());
+}
+
+struct Notification
+{
+    long eventId;
+    uint32_t flags;
+    vector<std::byte> item1;
+    vector<std::byte> item2;
+};
+
+// Purpose: stub sink, records the notifications instead of sending them to the shell.
+struct RecordingSink
+{
+    vector<Notification>* notifications;
+
+    void Notify(long eventId, uint32_t flags, PCIDLIST_ABSOLUTE, PCUIDLIST_RELATIVE item1, PCUIDLIST_RELATIVE item2) const
+    {
+        notifications->push_back({eventId, flags, Copy(item1), Copy(item2)});
+    }
+
+    static vector<std::byte> Copy(PCUIDLIST_RELATIVE pidl)
+    {
+        if (!pidl)
+            return {};
+
+        const auto* bytes = reinterpret_cast<const std::byte*>(pidl);
+        return vector<std::byte>(bytes, bytes + GetPidlSize(pidl));
+    }
+};
+
+const vector<std::byte> Folder = CreatePidl("folder");
+
+PCIDLIST_ABSOLUTE GetFolder() noexcept
+{
+    return reinterpret_cast<PCIDLIST_ABSOLUTE>(Folder.data());
+}
+
+} // namespace
+
+
+TEST_CLASS(ChangeNotifyBatcherTest)
+{
+public:
+    TEST_METHOD(FlushSendsEventsInOrder)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 10, RecordingSink{&notifications});
+        const auto item1 = CreatePidl("a");
+        const auto item2 = CreatePidl("b");
+
+        batcher.Add(SHCNE_DELETE, AsPidl(item1));
+        batcher.Add(SHCNE_DELETE, AsPidl(item2));
+        Assert::AreEqual(size_t{0}, notifications.size()); // nothing is sent before the flush.
+        batcher.Flush();
+
+        Assert::AreEqual(size_t{2}, notifications.size());
+        Assert::IsTrue(item1 == notifications[0].item1);
+        Assert::IsTrue(item2 == notifications[1].item1);
+        Assert::AreEqual(static_cast<long>(SHCNE_DELETE), notifications[1].eventId);
+    }
+
+    TEST_METHOD(OnlyLastEventFlushesWithoutWaiting)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 10, RecordingSink{&notifications});
+        const auto item1 = CreatePidl("a");
+        const auto item2 = CreatePidl("b");
+
+        batcher.Add(SHCNE_CREATE, AsPidl(item1));
+        batcher.Add(SHCNE_CREATE, AsPidl(item2));
+        batcher.Flush();
+
+        Assert::AreEqual(0U, notifications[0].flags);
+        Assert::AreEqual(static_cast<uint32_t>(SHCNF_FLUSHNOWAIT), notifications[1].flags);
+    }
+
+    TEST_METHOD(FlushFlagsAreUsedForLastEvent)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 10, RecordingSink{&notifications});
+        const auto item1 = CreatePidl("a");
+        const auto item2 = CreatePidl("b");
+
+        batcher.Add(SHCNE_CREATE, AsPidl(item1));
+        batcher.Add(SHCNE_CREATE, AsPidl(item2));
+        batcher.Flush(SHCNF_FLUSH);
+
+        Assert::AreEqual(0U, notifications[0].flags);
+        Assert::AreEqual(static_cast<uint32_t>(SHCNF_FLUSH), notifications[1].flags);
+    }
+
+    TEST_METHOD(BatchersShareProcessTableAndReleaseTheirEntries)
+    {
+        const size_t count = PidlInternTable::GetProcessTable().GetCount();
+        const auto item1 = CreatePidl("shared a");
+        const auto item2 = CreatePidl("shared b");
+        {
+            vector<Notification> notifications;
+            ChangeNotifyBatcher<RecordingSink> batcher1(GetFolder(), 10, RecordingSink{&notifications});
+            ChangeNotifyBatcher<RecordingSink> batcher2(GetFolder(), 10, RecordingSink{&notifications});
+            batcher1.Add(SHCNE_CREATE, AsPidl(item1));
+            batcher2.Add(SHCNE_CREATE, AsPidl(item1));
+            batcher2.Add(SHCNE_RENAMEITEM, AsPidl(item1), AsPidl(item2));
+
+            Assert::AreEqual(count + 2, PidlInternTable::GetProcessTable().GetCount());
+            batcher1.Flush();
+            Assert::AreEqual(count + 2, PidlInternTable::GetProcessTable().GetCount());
+        } // batcher2 is destroyed without a flush.
+
+        Assert::AreEqual(count, PidlInternTable::GetProcessTable().GetCount());
+    }
+
+    TEST_METHOD(EqualEventsAreSentOnce)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 10, RecordingSink{&notifications});
+        const auto item1 = CreatePidl("a");
+        const auto item1Copy = CreatePidl("a");
+
+        batcher.Add(SHCNE_ATTRIBUTES, AsPidl(item1));
+        batcher.Add(SHCNE_ATTRIBUTES, AsPidl(item1Copy));
+        batcher.Add(SHCNE_DELETE, AsPidl(item1));
+
+        Assert::AreEqual(size_t{2}, batcher.GetEventCount());
+    }
+
+    TEST_METHOD(RenameComparesBothItems)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 10, RecordingSink{&notifications});
+        const auto item1 = CreatePidl("a");
+        const auto item2 = CreatePidl("b");
+        const auto item3 = CreatePidl("c");
+
+        batcher.Add(SHCNE_RENAMEITEM, AsPidl(item1), AsPidl(item2));
+        batcher.Add(SHCNE_RENAMEITEM, AsPidl(item1), AsPidl(item3));
+        batcher.Add(SHCNE_RENAMEITEM, AsPidl(item1), AsPidl(item2));
+        batcher.Flush();
+
+        Assert::AreEqual(size_t{2}, notifications.size());
+        Assert::IsTrue(item3 == notifications[1].item2);
+    }
+
+    TEST_METHOD(CollapseAboveThreshold)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 3, RecordingSink{&notifications});
+        vector<vector<std::byte>> items;
+        for (char c = 'a'; c <= 'z'; ++c)
+        {
+            items.push_back(CreatePidl(string_view(&c, 1)));
+        }
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            batcher.Add(SHCNE_DELETE, AsPidl(items[i]));
+        }
+
+        Assert::IsFalse(batcher.IsCollapsed()); // the threshold itself is not collapsed.
+
+        for (const auto& item : items)
+        {
+            batcher.Add(SHCNE_DELETE, AsPidl(item));
+        }
+
+        Assert::IsTrue(batcher.IsCollapsed());
+        batcher.Flush();
+
+        Assert::AreEqual(size_t{1}, notifications.size());
+        Assert::AreEqual(static_cast<long>(SHCNE_UPDATEDIR), notifications[0].eventId);
+        Assert::AreEqual(static_cast<uint32_t>(SHCNF_FLUSHNOWAIT), notifications[0].flags);
+        Assert::IsTrue(notifications[0].item1.empty()); // the folder itself is reported.
+    }
+
+    TEST_METHOD(DuplicatesDoNotCountForThreshold)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 1, RecordingSink{&notifications});
+        const auto item1 = CreatePidl("a");
+
+        batcher.Add(SHCNE_CREATE, AsPidl(item1));
+        batcher.Add(SHCNE_CREATE, AsPidl(item1));
+
+        Assert::IsFalse(batcher.IsCollapsed());
+    }
+
+    TEST_METHOD(FlushResetsBatcher)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 1, RecordingSink{&notifications});
+        const auto item1 = CreatePidl("a");
+        const auto item2 = CreatePidl("b");
+
+        batcher.Add(SHCNE_CREATE, AsPidl(item1));
+        batcher.Add(SHCNE_CREATE, AsPidl(item2));
+        batcher.Flush();
+        batcher.Add(SHCNE_CREATE, AsPidl(item1));
+        batcher.Flush();
+
+        Assert::AreEqual(size_t{2}, notifications.size());
+        Assert::AreEqual(static_cast<long>(SHCNE_CREATE), notifications[1].eventId);
+        Assert::AreEqual(size_t{0}, batcher.GetEventCount());
+    }
+
+    TEST_METHOD(EmptyFlushSendsNothing)
+    {
+        vector<Notification> notifications;
+        ChangeNotifyBatcher<RecordingSink> batcher(GetFolder(), 10, RecordingSink{&notifications});
+
+        batcher.Flush();
+
+        Assert::AreEqual(size_t{0}, notifications.size());
+    }
+};
@@ -0,0 +1,159 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/cida_builder.h>
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+// Purpose: creates the bytes of a PIDL with 1 SHITEMID (or an empty PIDL).
+vector<std::byte> CreatePidl(string_view itemId)
+{
+    vector<std::byte> pidl;
+    if (!itemId.empty())
+    {
+        const auto size = static_cast<uint16_t>(sizeof(uint16_t) + itemId.size());
+        pidl.push_back(static_cast<std::byte>(size & 0xFF));
+        pidl.push_back(static_cast<std::byte>(size >> 8));
+        for (const char c : itemId)
+        {
+            pidl.push_back(static_cast<std::byte>(c));
+        }
+    }
+
+    pidl.push_back(std::byte{});
+    pidl.push_back(std::byte{});
+    return pidl;
+}
+
+vector<std::byte> Build(const CidaBuilder& builder)
+{
+    vector<std::byte> cida(builder.GetSize(), std::byte{0xCC});
+    builder.Write(cida.data());
+    return cida;
+}
+
+uint32_t ReadUInt32(const vector<std::byte>& cida, size_t offset) noexcept
+{
+    uint32_t value;
+    std::memcpy(&value, cida.data() + offset, sizeof value);
+    return value;
+}
+
+// Purpose: returns the offset of a PIDL, index 0 is the folder.
+uint32_t GetOffset(const vector<std::byte>& cida, size_t index) noexcept
+{
+    return ReadUInt32(cida, sizeof(uint32_t) * (index + 1));
+}
+
+bool ContainsPidlAt(const vector<std::byte>& cida, uint32_t offset, const vector<std::byte>& pidl) noexcept
+{
+    return offset + pidl.size() <= cida.size() && std::memcmp(cida.data() + offset, pidl.data(), pidl.size()) == 0;
+}
+
+} // namespace
+
+
+TEST_CLASS(CidaBuilderTest)
+{
+public:
+    TEST_METHOD(FolderOnly)
+    {
+        const auto folder = CreatePidl("folder");
+        const CidaBuilder builder(folder.data());
+
+        const auto cida = Build(builder);
+
+        Assert::AreEqual(size_t{0}, builder.GetItemCount());
+        Assert::AreEqual(0U, ReadUInt32(cida, 0));
+        Assert::AreEqual(8U, GetOffset(cida, 0)); // cidl + 1 offset.
+        Assert::IsTrue(ContainsPidlAt(cida, 8, folder));
+    }
+
+    TEST_METHOD(HeaderAndItems)
+    {
+        const auto folder = CreatePidl("folder");
+        const auto item1 = CreatePidl("a");
+        const auto item2 = CreatePidl("bc");
+        CidaBuilder builder(folder.data(), 2);
+        builder.Add(item1.data());
+        builder.Add(item2.data());
+
+        const auto cida = Build(builder);
+
+        Assert::AreEqual(size_t{2}, builder.GetItemCount());
+        Assert::AreEqual(2U, ReadUInt32(cida, 0));
+        Assert::IsTrue(ContainsPidlAt(cida, GetOffset(cida, 0), folder));
+        Assert::IsTrue(ContainsPidlAt(cida, GetOffset(cida, 1), item1));
+        Assert::IsTrue(ContainsPidlAt(cida, GetOffset(cida, 2), item2));
+    }
+
+    TEST_METHOD(PidlsAreAlignedAndPaddedWithZeros)
+    {
+        const auto folder = CreatePidl("f"); // 5 bytes.
+        const auto item = CreatePidl("abc"); // 7 bytes.
+        CidaBuilder builder(folder.data());
+        builder.Add(item.data());
+
+        const auto cida = Build(builder);
+
+        Assert::AreEqual(12U, GetOffset(cida, 0));
+        Assert::AreEqual(20U, GetOffset(cida, 1));
+        Assert::AreEqual(size_t{28}, builder.GetSize());
+        Assert::IsTrue(cida[17] == std::byte{});
+        Assert::IsTrue(cida[27] == std::byte{});
+    }
+
+    TEST_METHOD(EmptyFolderPidl)
+    {
+        const auto desktop = CreatePidl("");
+        const auto item = CreatePidl("a");
+        CidaBuilder builder(desktop.data());
+        builder.Add(item.data());
+
+        const auto cida = Build(builder);
+
+        Assert::AreEqual(12U, GetOffset(cida, 0));
+        Assert::AreEqual(16U, GetOffset(cida, 1)); // the empty PIDL (2 bytes) is padded to 4.
+        Assert::IsTrue(ContainsPidlAt(cida, 16, item));
+    }
+
+    TEST_METHOD(ManyItems)
+    {
+        const auto folder = CreatePidl("folder");
+        vector<vector<std::byte>> items;
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            items.push_back(CreatePidl(string_view("item name", 1 + (i % 9))));
+        }
+
+        CidaBuilder builder(folder.data(), items.size());
+        for (const auto& item : items)
+        {
+            builder.Add(item.data());
+        }
+
+        const auto cida = Build(builder);
+
+        Assert::AreEqual(1000U, ReadUInt32(cida, 0));
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            const uint32_t offset = GetOffset(cida, i + 1);
+            Assert::AreEqual(0U, offset % 4);
+            Assert::IsTrue(ContainsPidlAt(cida, offset, items[i]));
+        }
+    }
+};
@@ -0,0 +1,176 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/drop_files.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::wstring;
+using std::wstring_view;
+using std::vector;
+
+namespace {
+
+// Purpose: the block is stored in uint32_t elements, which makes it aligned as an HGLOBAL is.
+vector<uint32_t> CreateBlock(const vector<wstring>& files)
+{
+    DropFilesBuilder<> builder(files.size());
+    for (const auto& file : files)
+    {
+        builder.Add(file);
+    }
+
+    vector<uint32_t> block((builder.GetSize() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    builder.Write(block.data());
+    return block;
+}
+
+size_t GetBlockSize(const vector<wstring>& files)
+{
+    DropFilesBuilder<> builder;
+    for (const auto& file : files)
+    {
+        builder.Add(file);
+    }
+
+    return builder.GetSize();
+}
+
+vector<uint32_t> CreateBlock(const DropFilesHeader& header, wstring_view files)
+{
+    vector<uint32_t> block((sizeof header + (files.size() * sizeof(wchar_t)) + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    memcpy(block.data(), &header, sizeof header);
+    memcpy(reinterpret_cast<std::byte*>(block.data()) + sizeof header, files.data(), files.size() * sizeof(wchar_t));
+    return block;
+}
+
+} // namespace
+
+
+TEST_CLASS(DropFilesTest)
+{
+public:
+    TEST_METHOD(HeaderMatchesDropFiles)
+    {
+        Assert::AreEqual(sizeof(DROPFILES), sizeof(DropFilesHeader));
+        Assert::AreEqual(offsetof(DROPFILES, fWide), offsetof(DropFilesHeader, wide));
+    }
+
+    TEST_METHOD(BuildAndParse)
+    {
+        const vector<wstring> files{L"c:\\a.txt", L"c:\\folder\\b.txt", L"d:\\c"};
+        const auto block = CreateBlock(files);
+
+        const auto parsedFiles = ParseDropFiles(block.data(), GetBlockSize(files));
+
+        Assert::AreEqual(files.size(), parsedFiles.size());
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            Assert::AreEqual(files[i], wstring(parsedFiles[i]));
+        }
+    }
+
+    TEST_METHOD(BuildAndParseEmptyList)
+    {
+        const auto block = CreateBlock(vector<wstring>());
+
+        Assert::AreEqual(sizeof(DropFilesHeader) + sizeof(wchar_t), GetBlockSize({}));
+        Assert::IsTrue(ParseDropFiles(block.data(), GetBlockSize({})).empty());
+    }
+
+    TEST_METHOD(LongPathIsNotTruncated)
+    {
+        const vector<wstring> files{L"\\\\?\\c:\\" + wstring(40000, L'x'), L"c:\\short"};
+        const auto block = CreateBlock(files);
+
+        const auto parsedFiles = ParseDropFiles(block.data(), GetBlockSize(files));
+
+        Assert::AreEqual(size_t{2}, parsedFiles.size());
+        Assert::AreEqual(files[0].size(), parsedFiles[0].size());
+        Assert::AreEqual(files[1], wstring(parsedFiles[1]));
+    }
+
+    TEST_METHOD(DragQueryFileReadsBuiltBlock)
+    {
+        const vector<wstring> files{L"c:\\a.txt", L"c:\\b.txt"};
+        const auto block = CreateBlock(files);
+        const auto hdrop = static_cast<HDROP>(GlobalAlloc(GMEM_FIXED, GetBlockSize(files)));
+        memcpy(hdrop, block.data(), GetBlockSize(files));
+
+        wchar_t fileName[MAX_PATH];
+        Assert::AreEqual(2U, DragQueryFile(hdrop, static_cast<uint32_t>(-1), nullptr, 0));
+        Assert::AreNotEqual(0U, DragQueryFile(hdrop, 1, fileName, _countof(fileName)));
+        Assert::AreEqual(files[1].c_str(), fileName);
+        GlobalFree(hdrop);
+    }
+
+    TEST_METHOD(EndOfBlockEndsList)
+    {
+        const auto block = CreateBlock(DropFilesHeader{sizeof(DropFilesHeader), 0, 0, 0, 1}, wstring_view(L"a\0b", 4));
+
+        const auto parsedFiles = ParseDropFiles(block.data(), sizeof(DropFilesHeader) + (4 * sizeof(wchar_t)));
+
+        Assert::AreEqual(size_t{2}, parsedFiles.size());
+        Assert::AreEqual(wstring(L"b"), wstring(parsedFiles[1]));
+    }
+
+    TEST_METHOD(UnterminatedFileNameIsRejected)
+    {
+        const auto block = CreateBlock(DropFilesHeader{sizeof(DropFilesHeader), 0, 0, 0, 1}, L"abc");
+
+        Assert::ExpectException<std::invalid_argument>([&block] {
+            (void)ParseDropFiles(block.data(), sizeof(DropFilesHeader) + (3 * sizeof(wchar_t)));
+        });
+    }
+
+    TEST_METHOD(InvalidFileListOffsetIsRejected)
+    {
+        const auto block = CreateBlock(DropFilesHeader{100, 0, 0, 0, 1}, wstring_view(L"a\0\0", 3));
+
+        Assert::ExpectException<std::invalid_argument>([&block] {
+            (void)ParseDropFiles(block.data(), sizeof(DropFilesHeader) + (3 * sizeof(wchar_t)));
+        });
+    }
+
+    TEST_METHOD(AnsiBlockIsNotWide)
+    {
+        const auto block = CreateBlock(DropFilesHeader{sizeof(DropFilesHeader), 0, 0, 0, 0}, wstring_view(L"\0", 1));
+
+        Assert::IsFalse(IsWideDropFiles(block.data(), sizeof(DropFilesHeader) + sizeof(wchar_t)));
+        Assert::ExpectException<std::invalid_argument>([&block] {
+            (void)ParseDropFiles(block.data(), sizeof(DropFilesHeader) + sizeof(wchar_t));
+        });
+    }
+
+    TEST_METHOD(EmptyFileNameIsRejected)
+    {
+        DropFilesBuilder<> builder;
+
+        Assert::ExpectException<std::invalid_argument>([&builder] { builder.Add(L""); });
+        Assert::ExpectException<std::invalid_argument>([&builder] { builder.Add(wstring_view(L"a\0b", 3)); });
+    }
+
+    TEST_METHOD(ParseManyFiles)
+    {
+        vector<wstring> files;
+        for (size_t i = 0; i < 100000; ++i)
+        {
+            files.push_back(L"c:\\folder\\file" + std::to_wstring(i) + L".txt");
+        }
+
+        const auto block = CreateBlock(files);
+        const auto parsedFiles = ParseDropFiles(block.data(), GetBlockSize(files));
+
+        Assert::AreEqual(files.size(), parsedFiles.size());
+        Assert::AreEqual(files.back(), wstring(parsedFiles.back()));
+    }
+};
@@ -0,0 +1,81 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/enum_format_etc.h>
+
+#include <memory>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using ATL::CComPtr;
+
+namespace {
+
+std::shared_ptr<EnumFORMATETC::FormatEtcs> CreateFormatEtcs()
+{
+    auto formatEtcs = std::make_shared<EnumFORMATETC::FormatEtcs>();
+    for (const CLIPFORMAT format : {CLIPFORMAT{CF_TEXT}, CLIPFORMAT{CF_HDROP}})
+    {
+        formatEtcs->push_back(FORMATETC{format, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL});
+    }
+
+    return formatEtcs;
+}
+
+} // namespace
+
+
+TEST_CLASS(EnumFormatEtcTest)
+{
+public:
+    TEST_METHOD(NextReturnsFormats)
+    {
+        const auto enumFormatEtc = EnumFORMATETC::CreateInstance(CreateFormatEtcs());
+
+        FORMATETC formatEtcs[3];
+        ULONG fetched;
+        Assert::AreEqual(S_FALSE, enumFormatEtc->Next(3, formatEtcs, &fetched));
+
+        Assert::AreEqual(ULONG{2}, fetched);
+        Assert::AreEqual(CLIPFORMAT{CF_TEXT}, formatEtcs[0].cfFormat);
+        Assert::AreEqual(CLIPFORMAT{CF_HDROP}, formatEtcs[1].cfFormat);
+    }
+
+    TEST_METHOD(LastReleaseDestroysEnumerator)
+    {
+        auto formatEtcs = CreateFormatEtcs();
+        const std::weak_ptr<EnumFORMATETC::FormatEtcs> weakFormatEtcs = formatEtcs;
+
+        IEnumFORMATETC* enumFormatEtc = EnumFORMATETC::CreateInstance(std::move(formatEtcs)).Detach();
+        Assert::IsFalse(weakFormatEtcs.expired());
+
+        Assert::AreEqual(ULONG{0}, enumFormatEtc->Release());
+        Assert::IsTrue(weakFormatEtcs.expired());
+    }
+
+    TEST_METHOD(CloneKeepsFormatsAlive)
+    {
+        auto formatEtcs = CreateFormatEtcs();
+        const std::weak_ptr<EnumFORMATETC::FormatEtcs> weakFormatEtcs = formatEtcs;
+
+        IEnumFORMATETC* enumFormatEtc = EnumFORMATETC::CreateInstance(std::move(formatEtcs)).Detach();
+        FORMATETC formatEtc;
+        Assert::AreEqual(S_OK, enumFormatEtc->Next(1, &formatEtc, nullptr));
+        IEnumFORMATETC* clone;
+        Assert::AreEqual(S_OK, enumFormatEtc->Clone(&clone));
+
+        Assert::AreEqual(ULONG{0}, enumFormatEtc->Release());
+        Assert::IsFalse(weakFormatEtcs.expired());
+
+        Assert::AreEqual(S_OK, clone->Next(1, &formatEtc, nullptr));
+        Assert::AreEqual(CLIPFORMAT{CF_HDROP}, formatEtc.cfFormat);
+
+        Assert::AreEqual(ULONG{0}, clone->Release());
+        Assert::IsTrue(weakFormatEtcs.expired());
+    }
+};
@@ -0,0 +1,153 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/enum_id_list_impl.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using namespace ATL;
+using std::vector;
+
+namespace {
+
+// Purpose: enumerates the items 0 .. ItemCount - 1 and counts how often the storage is read.
+class __declspec(novtable) CountingEnumIDList :
+    public CComObjectRootEx<CComSingleThreadModel>,
+    public IEnumIDListImpl<CountingEnumIDList>
+{
+public:
+    BEGIN_COM_MAP(CountingEnumIDList)
+        COM_INTERFACE_ENTRY(IEnumIDList)
+    END_COM_MAP()
+
+    static constexpr uint32_t ItemCount = 10;
+
+    static CComPtr<IEnumIDList> CreateInstance(CComObject<CountingEnumIDList>** instance)
+    {
+        Assert::AreEqual(S_OK, CComObject<CountingEnumIDList>::CreateInstance(instance));
+        return CComPtr<IEnumIDList>(*instance);
+    }
+
+    LPITEMIDLIST GetNextItem()
+    {
+        ++m_readCount;
+        if (m_next == ItemCount)
+            return nullptr;
+
+        const PUIDLIST_RELATIVE pidl = ItemIDList::CreateItemIdListWithTerminator(sizeof(uint32_t));
+        std::memcpy(pidl->mkid.abID, &m_next, sizeof m_next);
+        ++m_next;
+        return pidl;
+    }
+
+    [[nodiscard]] uint32_t GetReadCount() const noexcept
+    {
+        return m_readCount;
+    }
+
+    CountingEnumIDList(const CountingEnumIDList&) = delete;
+    CountingEnumIDList(CountingEnumIDList&&) = delete;
+    CountingEnumIDList& operator=(const CountingEnumIDList&) = delete;
+    CountingEnumIDList& operator=(CountingEnumIDList&&) = delete;
+
+protected:
+    CountingEnumIDList() noexcept(false) = default; // noexcept(false) needed as ATL base class is not defined noexcept.
+    ~CountingEnumIDList() = default;
+
+private:
+    uint32_t m_next{};
+    uint32_t m_readCount{};
+};
+
+// Purpose: returns the indexes of the next 'count' items.
+vector<uint32_t> Next(IEnumIDList* enumIdList, ULONG count)
+{
+    vector<PITEMID_CHILD> items(count);
+    ULONG fetched;
+    const HRESULT result = enumIdList->Next(count, items.data(), &fetched);
+    Assert::IsTrue(result == (fetched == count ? S_OK : S_FALSE));
+
+    vector<uint32_t> indexes;
+    for (ULONG i = 0; i < fetched; ++i)
+    {
+        uint32_t index;
+        std::memcpy(&index, items[i]->mkid.abID, sizeof index);
+        indexes.push_back(index);
+        CoTaskMemFree(items[i]);
+    }
+
+    return indexes;
+}
+
+} // namespace
+
+
+TEST_CLASS(EnumIDListImplTest)
+{
+public:
+    TEST_METHOD(NextResetNextDoesNotReadAgain)
+    {
+        CComObject<CountingEnumIDList>* instance;
+        const auto enumIdList = CountingEnumIDList::CreateInstance(&instance);
+
+        Assert::IsTrue(vector<uint32_t>{0, 1, 2} == Next(enumIdList, 3));
+        Assert::AreEqual(3U, instance->GetReadCount());
+
+        Assert::AreEqual(S_OK, enumIdList->Reset());
+        Assert::IsTrue(vector<uint32_t>{0, 1, 2} == Next(enumIdList, 3));
+        Assert::AreEqual(3U, instance->GetReadCount());
+
+        // Continue after the recorded items: only the remaining items are read.
+        Assert::IsTrue(vector<uint32_t>{3, 4, 5, 6, 7, 8, 9} == Next(enumIdList, 20));
+        Assert::AreEqual(CountingEnumIDList::ItemCount + 1, instance->GetReadCount()); // + 1 for the end.
+    }
+
+    TEST_METHOD(ResetAfterLastItem)
+    {
+        CComObject<CountingEnumIDList>* instance;
+        const auto enumIdList = CountingEnumIDList::CreateInstance(&instance);
+        Assert::AreEqual(size_t{CountingEnumIDList::ItemCount}, Next(enumIdList, 20).size());
+
+        Assert::AreEqual(S_OK, enumIdList->Reset());
+
+        Assert::AreEqual(size_t{CountingEnumIDList::ItemCount}, Next(enumIdList, 20).size());
+        Assert::AreEqual(CountingEnumIDList::ItemCount + 1, instance->GetReadCount());
+    }
+
+    TEST_METHOD(SkipReadsAhead)
+    {
+        CComObject<CountingEnumIDList>* instance;
+        const auto enumIdList = CountingEnumIDList::CreateInstance(&instance);
+
+        Assert::AreEqual(S_OK, enumIdList->Skip(4));
+        Assert::IsTrue(vector<uint32_t>{4} == Next(enumIdList, 1));
+        Assert::AreEqual(S_FALSE, enumIdList->Skip(100));
+
+        Assert::AreEqual(S_OK, enumIdList->Reset());
+        Assert::IsTrue(vector<uint32_t>{0} == Next(enumIdList, 1));
+    }
+
+    TEST_METHOD(CloneStartsAtSamePosition)
+    {
+        CComObject<CountingEnumIDList>* instance;
+        const auto enumIdList = CountingEnumIDList::CreateInstance(&instance);
+        Assert::IsTrue(vector<uint32_t>{0, 1} == Next(enumIdList, 2));
+
+        CComPtr<IEnumIDList> clone;
+        Assert::AreEqual(S_OK, enumIdList->Clone(&clone));
+
+        Assert::IsTrue(vector<uint32_t>{2, 3} == Next(clone, 2));
+        Assert::IsTrue(vector<uint32_t>{2} == Next(enumIdList, 1));
+        Assert::AreEqual(S_OK, clone->Reset());
+        Assert::IsTrue(vector<uint32_t>{0} == Next(clone, 1));
+        Assert::AreEqual(CountingEnumIDList::ItemCount + 1, instance->GetReadCount());
+    }
+};
@@ -0,0 +1,222 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/generator_stream.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using ATL::CComPtr;
+using std::vector;
+
+namespace {
+
+// Purpose: every byte of the content is derived from its offset, which makes it possible to check any range.
+std::byte GetContentByte(uint64_t offset) noexcept
+{
+    return static_cast<std::byte>((offset ^ (offset >> 12)) & 0xFF);
+}
+
+// Purpose: reader that records what was requested.
+struct ReaderStatistics
+{
+    size_t callCount{};
+    size_t largestRequest{};
+    uint64_t requestedBytes{};
+};
+
+CComPtr<IStream> CreateStream(uint64_t size, ReaderStatistics& statistics)
+{
+    return GeneratorStream::CreateInstance(size, [&statistics](uint64_t offset, std::byte* buffer, size_t count) {
+        ++statistics.callCount;
+        statistics.largestRequest = std::max(statistics.largestRequest, count);
+        statistics.requestedBytes += count;
+        for (size_t i = 0; i < count; ++i)
+        {
+            buffer[i] = GetContentByte(offset + i);
+        }
+    }, L"item.bin");
+}
+
+bool IsContent(const vector<std::byte>& buffer, uint64_t offset, size_t count) noexcept
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (buffer[i] != GetContentByte(offset + i))
+            return false;
+    }
+
+    return true;
+}
+
+uint64_t Seek(IStream* stream, int64_t move, DWORD origin)
+{
+    LARGE_INTEGER distance;
+    distance.QuadPart = move;
+    ULARGE_INTEGER position;
+    Assert::AreEqual(S_OK, stream->Seek(distance, origin, &position));
+    return position.QuadPart;
+}
+
+} // namespace
+
+
+TEST_CLASS(GeneratorStreamTest)
+{
+public:
+    TEST_METHOD(StatReturnsFinalSize)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(5ULL * 1024 * 1024 * 1024, statistics);
+
+        STATSTG statstg;
+        Assert::AreEqual(S_OK, stream->Stat(&statstg, STATFLAG_DEFAULT));
+
+        Assert::AreEqual(5ULL * 1024 * 1024 * 1024, statstg.cbSize.QuadPart);
+        Assert::AreEqual(static_cast<DWORD>(STGTY_STREAM), statstg.type);
+        Assert::AreEqual(L"item.bin", statstg.pwcsName);
+        Assert::AreEqual(size_t{0}, statistics.callCount); // Stat doesn't produce content.
+        CoTaskMemFree(statstg.pwcsName);
+    }
+
+    TEST_METHOD(ReadAcrossChunks)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(GeneratorStream::ChunkSize * 3 + 100, statistics);
+
+        vector<std::byte> buffer(GeneratorStream::ChunkSize + 10);
+        ULONG read;
+        Assert::AreEqual(S_OK, stream->Read(buffer.data(), 10, &read));
+        Assert::AreEqual(S_OK, stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+
+        Assert::AreEqual(static_cast<ULONG>(buffer.size()), read);
+        Assert::IsTrue(IsContent(buffer, 10, read));
+    }
+
+    TEST_METHOD(ReadAtEndReturnsRemainingBytes)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(GeneratorStream::ChunkSize + 100, statistics);
+
+        Seek(stream, -40, STREAM_SEEK_END);
+        vector<std::byte> buffer(100);
+        ULONG read;
+        Assert::AreEqual(S_FALSE, stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+
+        Assert::AreEqual(ULONG{40}, read);
+        Assert::IsTrue(IsContent(buffer, GeneratorStream::ChunkSize + 60, read));
+        Assert::AreEqual(S_FALSE, stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+        Assert::AreEqual(ULONG{0}, read);
+    }
+
+    TEST_METHOD(SeekOnlyProducesReadChunk)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(8ULL * 1024 * 1024 * 1024, statistics);
+
+        Assert::AreEqual(6ULL * 1024 * 1024 * 1024, Seek(stream, 6LL * 1024 * 1024 * 1024, STREAM_SEEK_SET));
+        vector<std::byte> buffer(1000);
+        ULONG read;
+        Assert::AreEqual(S_OK, stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+
+        Assert::IsTrue(IsContent(buffer, 6ULL * 1024 * 1024 * 1024, read));
+        Assert::AreEqual(size_t{1}, statistics.callCount);
+        Assert::AreEqual(6ULL * 1024 * 1024 * 1024 + 1000, Seek(stream, 0, STREAM_SEEK_CUR));
+    }
+
+    TEST_METHOD(MemoryCeiling)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(4ULL * 1024 * 1024 * 1024 + 1, statistics);
+
+        // Read the first 32 MB with large reads, as a copy engine would do.
+        vector<std::byte> buffer(1024 * 1024);
+        for (int i = 0; i < 32; ++i)
+        {
+            ULONG read;
+            Assert::AreEqual(S_OK, stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+            Assert::IsTrue(IsContent(buffer, static_cast<uint64_t>(i) * buffer.size(), read));
+        }
+
+        // The content is produced once, in chunks: never more than 1 chunk is requested at a time.
+        Assert::AreEqual(GeneratorStream::ChunkSize, statistics.largestRequest);
+        Assert::AreEqual(32ULL * 1024 * 1024, statistics.requestedBytes);
+    }
+
+    TEST_METHOD(CloneSharesPositionNotState)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(GeneratorStream::ChunkSize * 2, statistics);
+        Seek(stream, 100, STREAM_SEEK_SET);
+
+        CComPtr<IStream> clone;
+        Assert::AreEqual(S_OK, stream->Clone(&clone));
+        Seek(stream, 0, STREAM_SEEK_SET);
+
+        Assert::AreEqual(uint64_t{100}, Seek(clone, 0, STREAM_SEEK_CUR));
+        vector<std::byte> buffer(10);
+        ULONG read;
+        Assert::AreEqual(S_OK, clone->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+        Assert::IsTrue(IsContent(buffer, 100, read));
+    }
+
+    TEST_METHOD(CopyToCopiesRequestedBytes)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(GeneratorStream::ChunkSize * 2 + 10, statistics);
+        CComPtr<IStream> target;
+        Assert::AreEqual(S_OK, CreateStreamOnHGlobal(nullptr, true, &target));
+
+        ULARGE_INTEGER cb;
+        cb.QuadPart = GeneratorStream::ChunkSize + 20;
+        ULARGE_INTEGER read;
+        ULARGE_INTEGER written;
+        Assert::AreEqual(S_OK, stream->CopyTo(target, cb, &read, &written));
+
+        Assert::AreEqual(cb.QuadPart, read.QuadPart);
+        Assert::AreEqual(cb.QuadPart, written.QuadPart);
+        Assert::AreEqual(cb.QuadPart, Seek(stream, 0, STREAM_SEEK_CUR));
+
+        Seek(target, 0, STREAM_SEEK_SET);
+        vector<std::byte> buffer(static_cast<size_t>(cb.QuadPart));
+        ULONG bufferRead;
+        Assert::AreEqual(S_OK, target->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bufferRead));
+        Assert::IsTrue(IsContent(buffer, 0, bufferRead));
+    }
+
+    TEST_METHOD(CopyToFailedWriteKeepsPosition)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(1000, statistics);
+        const auto readOnlyTarget = CreateStream(1000, statistics);
+        Seek(stream, 100, STREAM_SEEK_SET);
+
+        ULARGE_INTEGER cb;
+        cb.QuadPart = 500;
+        ULARGE_INTEGER read;
+        ULARGE_INTEGER written;
+        Assert::AreEqual(STG_E_ACCESSDENIED, stream->CopyTo(readOnlyTarget, cb, &read, &written));
+
+        Assert::AreEqual(uint64_t{0}, read.QuadPart);
+        Assert::AreEqual(uint64_t{0}, written.QuadPart);
+        Assert::AreEqual(uint64_t{100}, Seek(stream, 0, STREAM_SEEK_CUR));
+    }
+
+    TEST_METHOD(WriteIsDenied)
+    {
+        ReaderStatistics statistics;
+        const auto stream = CreateStream(10, statistics);
+
+        const std::byte data[1]{};
+        ULONG written;
+        Assert::AreEqual(STG_E_ACCESSDENIED, stream->Write(data, 1, &written));
+        Assert::AreEqual(ULONG{0}, written);
+    }
+};
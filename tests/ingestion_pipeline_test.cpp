@@ -0,0 +1,154 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/ingestion_pipeline.h>
+
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::string;
+using std::vector;
+
+namespace {
+
+using Pipeline = IngestionPipeline<int, string>;
+
+vector<int> CreateSources(size_t count)
+{
+    vector<int> sources(count);
+    std::iota(sources.begin(), sources.end(), 0);
+    return sources;
+}
+
+bool IsPreparedInOrder(const vector<string>& records) noexcept
+{
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (records[i] != std::to_string(i))
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+TEST_CLASS(IngestionPipelineTest)
+{
+public:
+    TEST_METHOD(RecordsKeepSourceOrder)
+    {
+        const auto sources = CreateSources(Pipeline::BatchSize * 3 + 7);
+        bool committedInOrder = false;
+        bool publishedInOrder = false;
+        const Pipeline pipeline(
+            [](const int& source) { return std::to_string(source); },
+            [&committedInOrder](vector<string>& records) { committedInOrder = IsPreparedInOrder(records); },
+            [&publishedInOrder](const vector<string>& records) { publishedInOrder = IsPreparedInOrder(records); });
+
+        Assert::IsTrue(pipeline.Run(sources));
+
+        Assert::IsTrue(committedInOrder);
+        Assert::IsTrue(publishedInOrder);
+    }
+
+    TEST_METHOD(PublishGetsCommittedRecords)
+    {
+        const auto sources = CreateSources(10);
+        vector<string> published;
+        const Pipeline pipeline(
+            [](const int& source) { return std::to_string(source); },
+            [](vector<string>& records) {
+                for (auto& record : records)
+                {
+                    record += "!";
+                }
+            },
+            [&published](const vector<string>& records) { published = records; });
+
+        Assert::IsTrue(pipeline.Run(sources));
+
+        Assert::AreEqual(size_t{10}, published.size());
+        Assert::AreEqual(string("9!"), published[9]);
+    }
+
+    TEST_METHOD(ProgressIsCalledAfterEveryBatch)
+    {
+        const auto sources = CreateSources(Pipeline::BatchSize * 2 + 1);
+        vector<size_t> completed;
+        Pipeline pipeline([](const int& source) { return std::to_string(source); }, [](vector<string>&) {}, [](const vector<string>&) {});
+        pipeline.SetProgress([&completed](size_t count, size_t total) {
+            Assert::AreEqual(Pipeline::BatchSize * 2 + 1, total);
+            completed.push_back(count);
+            return true;
+        });
+
+        Assert::IsTrue(pipeline.Run(sources));
+
+        Assert::IsTrue(vector<size_t>{Pipeline::BatchSize, Pipeline::BatchSize * 2, Pipeline::BatchSize * 2 + 1} == completed);
+    }
+
+    TEST_METHOD(CancelBeforeCommit)
+    {
+        const auto sources = CreateSources(Pipeline::BatchSize * 4);
+        bool committed = false;
+        bool published = false;
+        size_t progressCount = 0;
+        Pipeline pipeline(
+            [](const int& source) { return std::to_string(source); },
+            [&committed](vector<string>&) { committed = true; },
+            [&published](const vector<string>&) { published = true; });
+        pipeline.SetProgress([&progressCount](size_t, size_t) {
+            ++progressCount;
+            return false;
+        });
+
+        Assert::IsFalse(pipeline.Run(sources));
+
+        Assert::AreEqual(size_t{1}, progressCount); // the remaining batches are not prepared.
+        Assert::IsFalse(committed);
+        Assert::IsFalse(published);
+    }
+
+    TEST_METHOD(PrepareExceptionIsRethrown)
+    {
+        const auto sources = CreateSources(Pipeline::BatchSize * 2);
+        bool committed = false;
+        const Pipeline pipeline(
+            [](const int& source) {
+                if (source == 300)
+                    throw std::runtime_error("cannot read source");
+
+                return std::to_string(source);
+            },
+            [&committed](vector<string>&) { committed = true; },
+            [](const vector<string>&) {});
+
+        Assert::ExpectException<std::runtime_error>([&pipeline, &sources] { pipeline.Run(sources); });
+
+        Assert::IsFalse(committed);
+    }
+
+    TEST_METHOD(EmptySourcesAreCommitted)
+    {
+        bool committed = false;
+        const Pipeline pipeline(
+            [](const int& source) { return std::to_string(source); },
+            [&committed](vector<string>& records) { committed = records.empty(); },
+            [](const vector<string>&) {});
+
+        Assert::IsTrue(pipeline.Run({}));
+
+        Assert::IsTrue(committed);
+    }
+};
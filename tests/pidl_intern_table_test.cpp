@@ -0,0 +1,185 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/pidl_intern_table.h>
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::string_view;
+using std::vector;
+
+namespace {
+
+// Purpose: creates the bytes of a PIDL with 1 SHITEMID per passed data string.
+vector<std::byte> CreatePidl(std::initializer_list<string_view> itemIds)
+{
+    vector<std::byte> pidl;
+    for (const auto itemId : itemIds)
+    {
+        const auto size = static_cast<uint16_t>(sizeof(uint16_t) + itemId.size());
+        pidl.push_back(static_cast<std::byte>(size & 0xFF));
+        pidl.push_back(static_cast<std::byte>(size >> 8));
+        for (const char c : itemId)
+        {
+            pidl.push_back(static_cast<std::byte>(c));
+        }
+    }
+
+    pidl.push_back(std::byte{});
+    pidl.push_back(std::byte{});
+    return pidl;
+}
+
+} // namespace
+
+
+TEST_CLASS(PidlInternTableTest)
+{
+public:
+    TEST_METHOD(GetPidlSize)
+    {
+        Assert::AreEqual(size_t{2}, msf::GetPidlSize(CreatePidl({}).data()));
+        Assert::AreEqual(size_t{5 + 4 + 2}, msf::GetPidlSize(CreatePidl({"abc", "de"}).data()));
+    }
+
+    TEST_METHOD(HashOfEqualPidlsIsEqual)
+    {
+        const auto pidl1 = CreatePidl({"folder", "file one"});
+        const auto pidl2 = CreatePidl({"folder", "file one"});
+
+        Assert::AreEqual(PidlHash()(pidl1.data()), PidlHash()(pidl2.data()));
+        Assert::IsTrue(PidlEqual()(pidl1.data(), pidl2.data()));
+    }
+
+    TEST_METHOD(HashCoversAllLevels)
+    {
+        const auto pidl1 = CreatePidl({"folder", "file one"});
+        const auto pidl2 = CreatePidl({"folder", "file two"});
+        const auto pidl3 = CreatePidl({"folder"});
+
+        Assert::AreNotEqual(PidlHash::Hash(pidl1.data()), PidlHash::Hash(pidl2.data()));
+        Assert::AreNotEqual(PidlHash::Hash(pidl1.data()), PidlHash::Hash(pidl3.data()));
+        Assert::IsFalse(PidlEqual()(pidl1.data(), pidl2.data()));
+    }
+
+    TEST_METHOD(InternEqualPidlsReturnsSameHandle)
+    {
+        PidlInternTable table;
+        const auto pidl1 = CreatePidl({"a", "b"});
+        const auto pidl2 = CreatePidl({"a", "b"});
+
+        const auto handle1 = table.Intern(pidl1.data());
+        const auto handle2 = table.Intern(pidl2.data());
+
+        Assert::AreNotEqual(PidlInternTable::InvalidHandle, handle1);
+        Assert::AreEqual(handle1, handle2);
+        Assert::AreEqual(size_t{1}, table.GetCount());
+    }
+
+    TEST_METHOD(InternDifferentPidlsReturnsDifferentHandles)
+    {
+        PidlInternTable table;
+
+        const auto handle1 = table.Intern(CreatePidl({"a"}).data());
+        const auto handle2 = table.Intern(CreatePidl({"b"}).data());
+
+        Assert::AreNotEqual(handle1, handle2);
+        Assert::AreEqual(size_t{2}, table.GetCount());
+    }
+
+    TEST_METHOD(GetPidlReturnsCopy)
+    {
+        PidlInternTable table;
+        auto pidl = CreatePidl({"abc"});
+
+        const auto handle = table.Intern(pidl.data());
+        pidl[2] = std::byte{'x'};
+
+        Assert::IsTrue(PidlEqual()(CreatePidl({"abc"}).data(), table.GetPidl(handle)));
+    }
+
+    TEST_METHOD(ReleaseRemovesLastReference)
+    {
+        PidlInternTable table;
+        const auto pidl = CreatePidl({"a"});
+
+        const auto handle = table.Intern(pidl.data());
+        table.AddRef(handle);
+        table.Release(handle);
+        Assert::AreEqual(size_t{1}, table.GetCount());
+
+        table.Release(handle);
+        Assert::AreEqual(size_t{0}, table.GetCount());
+    }
+
+    TEST_METHOD(InternAfterReleaseReusesSlot)
+    {
+        PidlInternTable table;
+        const auto pidl = CreatePidl({"a"});
+
+        const auto handle1 = table.Intern(pidl.data());
+        table.Release(handle1);
+        const auto handle2 = table.Intern(pidl.data());
+
+        Assert::AreEqual(handle1, handle2);
+        Assert::IsTrue(PidlEqual()(pidl.data(), table.GetPidl(handle2)));
+    }
+
+    TEST_METHOD(ConcurrentIntern)
+    {
+        constexpr size_t threadCount = 8;
+        constexpr size_t pidlCount = 256;
+
+        vector<vector<std::byte>> pidls;
+        for (size_t i = 0; i < pidlCount; ++i)
+        {
+            const auto name = std::to_string(i);
+            pidls.push_back(CreatePidl({"root", name}));
+        }
+
+        PidlInternTable table;
+        vector<vector<PidlInternTable::Handle>> handles(threadCount);
+        vector<std::thread> threads;
+        for (size_t t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&table, &pidls, &result = handles[t]] {
+                for (const auto& pidl : pidls)
+                {
+                    result.push_back(table.Intern(pidl.data()));
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        Assert::AreEqual(pidlCount, table.GetCount());
+        for (size_t t = 1; t < threadCount; ++t)
+        {
+            Assert::IsTrue(handles[0] == handles[t]);
+        }
+
+        for (const auto& threadHandles : handles)
+        {
+            for (const auto handle : threadHandles)
+            {
+                table.Release(handle);
+            }
+        }
+
+        Assert::AreEqual(size_t{0}, table.GetCount());
+    }
+};
@@ -0,0 +1,83 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/pidl_schema.h>
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::wstring_view;
+
+namespace {
+
+using ItemSchema = PidlSchema<uint16_t, bool, uint32_t, uint32_t, wstring_view>;
+using TwoStringSchema = PidlSchema<wstring_view, uint8_t, wstring_view, uint64_t>;
+
+} // namespace
+
+
+TEST_CLASS(PidlSchemaTest)
+{
+public:
+    TEST_METHOD(GetSize)
+    {
+        static_assert(ItemSchema::GetSize(0, false, 0, 0, wstring_view()) == 13 + sizeof(wchar_t));
+        Assert::AreEqual(size_t{13 + (6 * sizeof(wchar_t))}, ItemSchema::GetSize(0x5602, true, 1, 2, L"abcde"));
+    }
+
+    TEST_METHOD(WriteAndRead)
+    {
+        const wstring_view name{L"File One"};
+        std::vector<std::byte> buffer(ItemSchema::GetSize(0x5602, true, 42, 4711, name));
+        ItemSchema::Write(buffer.data(), 0x5602, true, 42, 4711, name);
+
+        const ItemSchema::View view(buffer.data(), buffer.size());
+        Assert::AreEqual(uint16_t{0x5602}, view.Get<0>());
+        Assert::IsTrue(view.Get<1>());
+        Assert::AreEqual(42U, view.Get<2>());
+        Assert::AreEqual(4711U, view.Get<3>());
+        Assert::IsTrue(name == view.Get<4>());
+        Assert::AreEqual(L'\0', view.Get<4>().data()[name.size()]);
+    }
+
+    TEST_METHOD(ReadReturnsViewOnData)
+    {
+        std::vector<std::byte> buffer(ItemSchema::GetSize(0, false, 0, 0, L"abc"));
+        ItemSchema::Write(buffer.data(), 0, false, 0, 0, L"abc");
+
+        const auto name = ItemSchema::View(buffer.data(), buffer.size()).Get<4>();
+        Assert::IsTrue(static_cast<const void*>(name.data()) == buffer.data() + 13);
+    }
+
+    TEST_METHOD(WriteAndReadMultipleStrings)
+    {
+        std::vector<std::byte> buffer(TwoStringSchema::GetSize(L"ab", 7, L"xyz", 99));
+        TwoStringSchema::Write(buffer.data(), L"ab", 7, L"xyz", 99);
+
+        const TwoStringSchema::View view(buffer.data(), buffer.size());
+        Assert::IsTrue(wstring_view(L"ab") == view.Get<0>());
+        Assert::AreEqual(uint8_t{7}, view.Get<1>());
+        Assert::IsTrue(wstring_view(L"xyz") == view.Get<2>());
+        Assert::AreEqual(uint64_t{99}, view.Get<3>());
+        Assert::IsTrue(TwoStringSchema::IsValid(buffer.data(), buffer.size()));
+    }
+
+    TEST_METHOD(IsValid)
+    {
+        std::vector<std::byte> buffer(ItemSchema::GetSize(1, false, 2, 3, L"name"));
+        ItemSchema::Write(buffer.data(), 1, false, 2, 3, L"name");
+
+        Assert::IsTrue(ItemSchema::IsValid(buffer.data(), buffer.size()));
+        Assert::IsFalse(ItemSchema::IsValid(buffer.data(), buffer.size() - 1));
+        Assert::IsFalse(ItemSchema::IsValid(buffer.data(), 12));
+
+        buffer[buffer.size() - 1] = std::byte{1}; // remove terminator.
+        Assert::IsFalse(ItemSchema::IsValid(buffer.data(), buffer.size()));
+    }
+};
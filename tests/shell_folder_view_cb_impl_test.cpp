@@ -0,0 +1,147 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/enum_id_list_impl.h>
+#include <msf/shell_folder_view_cb_impl.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using namespace ATL;
+
+
+namespace {
+
+template<bool Enable>
+class __declspec(novtable) ShellFolderViewCBTest :
+    public CComObjectRootEx<CComSingleThreadModel>,
+    public ShellFolderViewCBImpl<ShellFolderViewCBTest<Enable>>
+{
+public:
+    BEGIN_COM_MAP(ShellFolderViewCBTest)
+        COM_INTERFACE_ENTRY(IShellFolderViewCB)
+    END_COM_MAP()
+
+    static constexpr bool EnableBackgroundEnumeration = Enable;
+
+    ShellFolderViewCBTest(const ShellFolderViewCBTest&) = delete;
+    ShellFolderViewCBTest(ShellFolderViewCBTest&&) = delete;
+    ShellFolderViewCBTest& operator=(const ShellFolderViewCBTest&) = delete;
+    ShellFolderViewCBTest& operator=(ShellFolderViewCBTest&&) = delete;
+
+protected:
+    ShellFolderViewCBTest() noexcept(false) = default; // noexcept(false) needed as ATL base class is not defined noexcept.
+    ~ShellFolderViewCBTest() = default;
+};
+
+template<bool Enable>
+CComPtr<IShellFolderViewCB> CreateShellFolderViewCB(CComObject<ShellFolderViewCBTest<Enable>>** instance = nullptr)
+{
+    CComObject<ShellFolderViewCBTest<Enable>>* object;
+    Assert::AreEqual(S_OK, CComObject<ShellFolderViewCBTest<Enable>>::CreateInstance(&object));
+    CComPtr<IShellFolderViewCB> shellFolderViewCB(object);
+    if (instance)
+    {
+        *instance = object;
+    }
+
+    return shellFolderViewCB;
+}
+
+// Purpose: enumerator without an end, the cancellation is the only way to stop it.
+class __declspec(novtable) EndlessEnumIDList :
+    public CComObjectRootEx<CComSingleThreadModel>,
+    public IEnumIDListImpl<EndlessEnumIDList>
+{
+public:
+    BEGIN_COM_MAP(EndlessEnumIDList)
+        COM_INTERFACE_ENTRY(IEnumIDList)
+    END_COM_MAP()
+
+    static CComPtr<IEnumIDList> CreateInstance(std::shared_ptr<const std::atomic<bool>> cancelled)
+    {
+        CComObject<EndlessEnumIDList>* instance;
+        Assert::AreEqual(S_OK, CComObject<EndlessEnumIDList>::CreateInstance(&instance));
+        CComPtr<IEnumIDList> enumIdList(instance);
+        instance->SetCancellation(std::move(cancelled));
+        return enumIdList;
+    }
+
+    LPITEMIDLIST GetNextItem()
+    {
+        return ItemIDList::CreateItemIdListWithTerminator(sizeof(uint32_t));
+    }
+
+    EndlessEnumIDList(const EndlessEnumIDList&) = delete;
+    EndlessEnumIDList(EndlessEnumIDList&&) = delete;
+    EndlessEnumIDList& operator=(const EndlessEnumIDList&) = delete;
+    EndlessEnumIDList& operator=(EndlessEnumIDList&&) = delete;
+
+protected:
+    EndlessEnumIDList() noexcept(false) = default; // noexcept(false) needed as ATL base class is not defined noexcept.
+    ~EndlessEnumIDList() = default;
+};
+
+void FreeItems(PITEMID_CHILD* items, ULONG count) noexcept
+{
+    for (ULONG i = 0; i < count; ++i)
+    {
+        CoTaskMemFree(items[i]);
+    }
+}
+
+} // namespace
+
+
+TEST_CLASS(ShellFolderViewCBImplTest)
+{
+public:
+    TEST_METHOD(BackgroundEnumNotEnabled)
+    {
+        const auto shellFolderViewCB = CreateShellFolderViewCB<false>();
+
+        Assert::AreEqual(E_NOTIMPL, shellFolderViewCB->MessageSFVCB(SFVM_BACKGROUNDENUM, 0, 0));
+        Assert::AreEqual(E_NOTIMPL, shellFolderViewCB->MessageSFVCB(SFVM_BACKGROUNDENUMDONE, 0, 0));
+    }
+
+    TEST_METHOD(BackgroundEnumEnabled)
+    {
+        const auto shellFolderViewCB = CreateShellFolderViewCB<true>();
+
+        Assert::AreEqual(S_OK, shellFolderViewCB->MessageSFVCB(SFVM_BACKGROUNDENUM, 0, 0));
+        Assert::AreEqual(S_OK, shellFolderViewCB->MessageSFVCB(SFVM_BACKGROUNDENUMDONE, 0, 0));
+    }
+
+    TEST_METHOD(WindowClosingStopsEnumeration)
+    {
+        CComObject<ShellFolderViewCBTest<true>>* instance;
+        const auto shellFolderViewCB = CreateShellFolderViewCB<true>(&instance);
+        const auto enumIdList = EndlessEnumIDList::CreateInstance(instance->GetEnumCancellation());
+
+        PITEMID_CHILD items[10];
+        ULONG fetched{};
+        Assert::AreEqual(S_OK, enumIdList->Next(10, items, &fetched));
+        FreeItems(items, fetched);
+
+        shellFolderViewCB->MessageSFVCB(SFVM_WINDOWCLOSING, 0, 0);
+
+        Assert::AreEqual(S_FALSE, enumIdList->Next(10, items, &fetched));
+        Assert::AreEqual(0UL, fetched);
+    }
+
+    TEST_METHOD(WindowClosingCancelsEnumeration)
+    {
+        CComObject<ShellFolderViewCBTest<true>>* instance;
+        const auto shellFolderViewCB = CreateShellFolderViewCB<true>(&instance);
+        const auto cancelled = instance->GetEnumCancellation();
+        Assert::IsFalse(cancelled->load());
+
+        shellFolderViewCB->MessageSFVCB(SFVM_WINDOWCLOSING, 0, 0);
+
+        Assert::IsTrue(cancelled->load());
+    }
+};
@@ -0,0 +1,150 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/slab_allocator.h>
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::vector;
+
+namespace {
+
+// Purpose: backing allocator that counts the calls, which makes the slab usage observable.
+struct CountingAllocator final
+{
+    static void* Allocate(size_t size)
+    {
+        void* p = std::malloc(size);
+        if (!p)
+            throw std::bad_alloc();
+
+        ++allocateCount;
+        return p;
+    }
+
+    static void Free(void* p) noexcept
+    {
+        ++freeCount;
+        std::free(p);
+    }
+
+    static void Reset() noexcept
+    {
+        allocateCount = 0;
+        freeCount = 0;
+    }
+
+    static inline size_t allocateCount{};
+    static inline size_t freeCount{};
+};
+
+using TestSlabAllocator = SlabAllocator<CountingAllocator>;
+
+} // namespace
+
+
+TEST_CLASS(SlabAllocatorTest)
+{
+public:
+    TEST_METHOD(GetBlockSize)
+    {
+        Assert::AreEqual(size_t{32}, TestSlabAllocator::GetBlockSize(1));
+        Assert::AreEqual(size_t{32}, TestSlabAllocator::GetBlockSize(24)); // 24 + 8 byte header.
+        Assert::AreEqual(size_t{64}, TestSlabAllocator::GetBlockSize(25));
+        Assert::AreEqual(size_t{4096}, TestSlabAllocator::GetBlockSize(4088));
+        Assert::AreEqual(size_t{5000}, TestSlabAllocator::GetBlockSize(5000)); // large block.
+    }
+
+    TEST_METHOD(AllocateReturnsAlignedBlocks)
+    {
+        TestSlabAllocator allocator;
+
+        for (size_t size = 1; size < 5000; size += 37)
+        {
+            void* p = allocator.Allocate(size);
+            Assert::AreEqual(uintptr_t{0}, reinterpret_cast<uintptr_t>(p) % 8);
+            allocator.Free(p);
+        }
+    }
+
+    TEST_METHOD(FreedBlockIsReused)
+    {
+        TestSlabAllocator allocator;
+
+        void* p1 = allocator.Allocate(40);
+        allocator.Free(p1);
+        void* p2 = allocator.Allocate(50); // same size class.
+
+        Assert::IsTrue(p1 == p2);
+        allocator.Free(p2);
+    }
+
+    TEST_METHOD(SizeClassSharesSlab)
+    {
+        CountingAllocator::Reset();
+        TestSlabAllocator allocator;
+
+        vector<void*> blocks;
+        const size_t blocksPerSlab = TestSlabAllocator::SlabSize / 64;
+        for (size_t i = 0; i < blocksPerSlab; ++i)
+        {
+            blocks.push_back(allocator.Allocate(40));
+        }
+
+        Assert::AreEqual(size_t{1}, allocator.GetSlabCount());
+        Assert::AreEqual(size_t{1}, CountingAllocator::allocateCount);
+
+        blocks.push_back(allocator.Allocate(40));
+        Assert::AreEqual(size_t{2}, allocator.GetSlabCount());
+
+        for (void* block : blocks)
+        {
+            allocator.Free(block);
+        }
+
+        Assert::AreEqual(size_t{0}, CountingAllocator::freeCount); // slabs are kept until destruction.
+    }
+
+    TEST_METHOD(LargeBlockUsesBackingAllocator)
+    {
+        CountingAllocator::Reset();
+        TestSlabAllocator allocator;
+
+        void* p = allocator.Allocate(TestSlabAllocator::MaxBlockSize);
+        Assert::AreEqual(size_t{1}, CountingAllocator::allocateCount);
+        Assert::AreEqual(size_t{0}, allocator.GetSlabCount());
+
+        allocator.Free(p);
+        Assert::AreEqual(size_t{1}, CountingAllocator::freeCount);
+    }
+
+    TEST_METHOD(DestructorReturnsSlabs)
+    {
+        CountingAllocator::Reset();
+        {
+            TestSlabAllocator allocator;
+            allocator.Free(allocator.Allocate(10));
+            allocator.Free(allocator.Allocate(1000));
+        }
+
+        Assert::AreEqual(size_t{2}, CountingAllocator::allocateCount);
+        Assert::AreEqual(size_t{2}, CountingAllocator::freeCount);
+    }
+
+    TEST_METHOD(FreeNullIsAllowed)
+    {
+        TestSlabAllocator allocator;
+        allocator.Free(nullptr);
+
+        Assert::AreEqual(size_t{0}, allocator.GetSlabCount());
+    }
+};
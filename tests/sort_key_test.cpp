@@ -0,0 +1,141 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/sort_key.h>
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+using std::pair;
+using std::vector;
+
+namespace {
+
+struct ItemWithSortKey
+{
+    std::string_view GetSortKey(uint32_t) const noexcept;
+};
+
+struct ItemWithIntegerSortKey
+{
+    std::optional<uint64_t> GetIntegerSortKey(uint32_t) const noexcept;
+};
+
+struct ItemWithoutSortKey
+{
+};
+
+vector<pair<uint64_t, size_t>> CreateRandomKeys(size_t count, uint64_t modulo)
+{
+    std::mt19937_64 generator(count);
+    vector<pair<uint64_t, size_t>> values;
+    for (size_t i = 0; i < count; ++i)
+    {
+        values.emplace_back(generator() % modulo, i);
+    }
+
+    return values;
+}
+
+// Purpose: the reference result, a stable sort on the key.
+vector<pair<uint64_t, size_t>> StableSort(vector<pair<uint64_t, size_t>> values)
+{
+    std::stable_sort(values.begin(), values.end(), [](const auto& value1, const auto& value2) noexcept { return value1.first < value2.first; });
+    return values;
+}
+
+} // namespace
+
+
+TEST_CLASS(SortKeyTest)
+{
+public:
+    TEST_METHOD(HasSortKey)
+    {
+        Assert::IsTrue(HasSortKeyV<ItemWithSortKey>);
+        Assert::IsFalse(HasSortKeyV<ItemWithIntegerSortKey>);
+        Assert::IsFalse(HasSortKeyV<ItemWithoutSortKey>);
+    }
+
+    TEST_METHOD(HasIntegerSortKey)
+    {
+        Assert::IsTrue(HasIntegerSortKeyV<ItemWithIntegerSortKey>);
+        Assert::IsFalse(HasIntegerSortKeyV<ItemWithSortKey>);
+        Assert::IsFalse(HasIntegerSortKeyV<ItemWithoutSortKey>);
+    }
+
+    TEST_METHOD(CompareSortKeysIsUnsigned)
+    {
+        Assert::AreEqual(-1, CompareSortKeys("\x01", "\x80"));
+        Assert::AreEqual(1, CompareSortKeys("\xFF", "\x7F"));
+        Assert::AreEqual(0, CompareSortKeys("abc", "abc"));
+        Assert::AreEqual(-1, CompareSortKeys("ab", "abc")); // a prefix sorts first.
+    }
+
+    TEST_METHOD(RadixSortMatchesStableSort)
+    {
+        for (const size_t count : {size_t{2}, size_t{3}, size_t{100}, size_t{10000}})
+        {
+            auto values = CreateRandomKeys(count, UINT64_MAX);
+            const auto expected = StableSort(values);
+
+            RadixSortByKey(values);
+
+            Assert::IsTrue(expected == values);
+        }
+    }
+
+    TEST_METHOD(RadixSortIsStable)
+    {
+        auto values = CreateRandomKeys(10000, 10); // many equal keys.
+        const auto expected = StableSort(values);
+
+        RadixSortByKey(values);
+
+        Assert::IsTrue(expected == values);
+    }
+
+    TEST_METHOD(RadixSortOfEqualKeysKeepsOrder)
+    {
+        vector<pair<uint64_t, size_t>> values{{5, 0}, {5, 1}, {5, 2}};
+
+        RadixSortByKey(values);
+
+        Assert::AreEqual(size_t{0}, values[0].second);
+        Assert::AreEqual(size_t{2}, values[2].second);
+    }
+
+    TEST_METHOD(RadixSortOnComplementSortsDescending)
+    {
+        vector<pair<uint64_t, size_t>> values{{~uint64_t{1}, 0}, {~uint64_t{3}, 1}, {~uint64_t{2}, 2}, {~uint64_t{3}, 3}};
+
+        RadixSortByKey(values);
+
+        Assert::AreEqual(size_t{1}, values[0].second);
+        Assert::AreEqual(size_t{3}, values[1].second); // equal keys keep their order.
+        Assert::AreEqual(size_t{2}, values[2].second);
+        Assert::AreEqual(size_t{0}, values[3].second);
+    }
+
+    TEST_METHOD(RadixSortOfEmptyAndSingleValue)
+    {
+        vector<pair<uint64_t, size_t>> values;
+        RadixSortByKey(values);
+        Assert::IsTrue(values.empty());
+
+        values.emplace_back(42, 0);
+        RadixSortByKey(values);
+        Assert::AreEqual(uint64_t{42}, values[0].first);
+    }
+};
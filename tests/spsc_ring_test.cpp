@@ -0,0 +1,95 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/spsc_ring.h>
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+
+
+TEST_CLASS(SpscRingTest)
+{
+public:
+    TEST_METHOD(PopReturnsValuesInPushOrder)
+    {
+        SpscRing<int, 4> ring;
+        Assert::IsTrue(ring.TryPush(1));
+        Assert::IsTrue(ring.TryPush(2));
+
+        int value{};
+        Assert::IsTrue(ring.TryPop(value));
+        Assert::AreEqual(1, value);
+        Assert::IsTrue(ring.TryPop(value));
+        Assert::AreEqual(2, value);
+        Assert::IsFalse(ring.TryPop(value));
+    }
+
+    TEST_METHOD(PushFailsWhenFull)
+    {
+        SpscRing<int, 2> ring;
+        Assert::IsTrue(ring.IsEmpty());
+
+        Assert::IsTrue(ring.TryPush(1));
+        Assert::IsTrue(ring.TryPush(2));
+
+        Assert::IsTrue(ring.IsFull());
+        Assert::IsFalse(ring.TryPush(3));
+    }
+
+    TEST_METHOD(IndicesWrapAround)
+    {
+        SpscRing<int, 4> ring;
+
+        for (int i = 0; i < 100; ++i)
+        {
+            Assert::IsTrue(ring.TryPush(i));
+            int value{};
+            Assert::IsTrue(ring.TryPop(value));
+            Assert::AreEqual(i, value);
+        }
+
+        Assert::IsTrue(ring.IsEmpty());
+    }
+
+    TEST_METHOD(ProducerAndConsumerThread)
+    {
+        constexpr int count = 100000;
+        SpscRing<int, 64> ring;
+
+        std::thread producer([&ring] {
+            for (int i = 0; i < count; ++i)
+            {
+                while (!ring.TryPush(i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        bool ordered = true;
+        for (int expected = 0; expected < count;)
+        {
+            int value{};
+            if (ring.TryPop(value))
+            {
+                ordered = ordered && value == expected;
+                ++expected;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        producer.join();
+        Assert::IsTrue(ordered);
+        Assert::IsTrue(ring.IsEmpty());
+    }
+};
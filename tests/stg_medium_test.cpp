@@ -0,0 +1,133 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include <msf/stg_medium.h>
+
+#include <cstring>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace msf;
+
+namespace {
+
+constexpr char Content[] = "shared content";
+
+HGLOBAL CreateGlobal()
+{
+    const HGLOBAL global = GlobalAllocThrow(sizeof Content);
+    std::memcpy(global, Content, sizeof Content);
+    return global;
+}
+
+bool HasContent(HGLOBAL global) noexcept
+{
+    return GlobalSize(global) >= sizeof Content && std::memcmp(global, Content, sizeof Content) == 0;
+}
+
+} // namespace
+
+
+TEST_CLASS(StorageMediumTest)
+{
+public:
+    TEST_METHOD(SharedGlobalOwnerReferenceCount)
+    {
+        IUnknown* owner = SharedGlobalOwner::Create(CreateGlobal());
+
+        Assert::AreEqual(ULONG{2}, owner->AddRef());
+
+        IUnknown* unknown;
+        Assert::AreEqual(S_OK, owner->QueryInterface(IID_IUnknown, reinterpret_cast<void**>(&unknown)));
+        Assert::IsTrue(unknown == owner);
+        Assert::AreEqual(ULONG{2}, unknown->Release());
+
+        Assert::AreEqual(ULONG{1}, owner->Release());
+        Assert::AreEqual(ULONG{0}, owner->Release()); // frees the owner and the memory.
+    }
+
+    TEST_METHOD(SharedGlobalOwnerOnlySupportsIUnknown)
+    {
+        IUnknown* owner = SharedGlobalOwner::Create(CreateGlobal());
+
+        void* object;
+        Assert::AreEqual(E_NOINTERFACE, owner->QueryInterface(IID_IStream, &object));
+        Assert::IsNull(object);
+        Assert::AreEqual(ULONG{0}, owner->Release());
+    }
+
+    TEST_METHOD(CopyToCreatesWritableCopy)
+    {
+        const StorageMedium medium(CreateGlobal());
+        STGMEDIUM copy{};
+
+        medium.CopyTo(copy);
+
+        Assert::AreEqual(static_cast<DWORD>(TYMED_HGLOBAL), copy.tymed);
+        Assert::IsTrue(copy.hGlobal != medium.GetHGlobal());
+        Assert::IsNull(copy.pUnkForRelease);
+        Assert::IsNull(medium.pUnkForRelease);
+        Assert::IsTrue(HasContent(copy.hGlobal));
+
+        static_cast<char*>(copy.hGlobal)[0] = 'S';
+        Assert::IsTrue(HasContent(medium.GetHGlobal()));
+        ReleaseStgMedium(&copy);
+    }
+
+    TEST_METHOD(ShareToSharesMemory)
+    {
+        StorageMedium medium(CreateGlobal());
+        STGMEDIUM copy1{};
+        STGMEDIUM copy2{};
+
+        medium.ShareTo(copy1);
+        medium.ShareTo(copy2);
+
+        Assert::IsTrue(copy1.hGlobal == medium.GetHGlobal());
+        Assert::IsTrue(copy2.hGlobal == medium.GetHGlobal());
+        Assert::IsNotNull(medium.pUnkForRelease);
+        Assert::IsTrue(copy1.pUnkForRelease == medium.pUnkForRelease);
+        Assert::IsTrue(copy2.pUnkForRelease == medium.pUnkForRelease);
+
+        // 1 reference for the medium and 1 for every copy.
+        Assert::AreEqual(ULONG{4}, medium.pUnkForRelease->AddRef());
+        medium.pUnkForRelease->Release();
+
+        ReleaseStgMedium(&copy1);
+        ReleaseStgMedium(&copy2);
+    }
+
+    TEST_METHOD(SharedMemoryOutlivesMedium)
+    {
+        STGMEDIUM copy{};
+        {
+            StorageMedium medium(CreateGlobal());
+            medium.ShareTo(copy);
+        }
+
+        Assert::IsTrue(HasContent(copy.hGlobal));
+        Assert::AreEqual(ULONG{2}, copy.pUnkForRelease->AddRef()); // only the copy keeps the memory alive.
+        copy.pUnkForRelease->Release();
+        ReleaseStgMedium(&copy);
+    }
+
+    TEST_METHOD(CopyToAfterShareToStillCopies)
+    {
+        StorageMedium medium(CreateGlobal());
+        STGMEDIUM shared{};
+        STGMEDIUM copy{};
+
+        medium.ShareTo(shared);
+        medium.CopyTo(copy);
+
+        Assert::IsTrue(copy.hGlobal != medium.GetHGlobal());
+        Assert::IsNull(copy.pUnkForRelease);
+        Assert::IsTrue(HasContent(copy.hGlobal));
+        ReleaseStgMedium(&copy);
+        ReleaseStgMedium(&shared);
+    }
+};
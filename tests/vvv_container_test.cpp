@@ -0,0 +1,226 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include "../samples/vvvsample/vvv_container.h"
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using std::u16string_view;
+using std::vector;
+
+namespace {
+
+constexpr u16string_view IniText =
+    u"[Directory]\r\n"
+    u"Label=Root\r\n"
+    u"FileCount=3\r\n"
+    u"[File0]\r\n"
+    u"Name=a.txt\r\n"
+    u"Size=100\r\n"
+    u"Active=1\r\n"
+    u"[File1]\r\n"
+    u"Name=sub\r\n"
+    u"Active=1\r\n"
+    u"Folder=1\r\n"
+    u"[File3]\r\n"
+    u"Name=\"c d.txt\"\r\n"
+    u"Size=300\r\n"
+    u"Active=1\r\n"
+    u"[1\\Directory]\r\n"
+    u"Label=Sub\r\n"
+    u"FileCount=1\r\n"
+    u"[1\\File0]\r\n"
+    u"Name=inner.txt\r\n"
+    u"Size=7\r\n"
+    u"Active=1\r\n";
+
+vector<std::byte> CreateContainer()
+{
+    return VVVContainerModel::LoadFromIni(IniText).Serialize();
+}
+
+VVVContainerHeader GetHeader(const vector<std::byte>& container) noexcept
+{
+    VVVContainerHeader header;
+    std::memcpy(&header, container.data(), sizeof header);
+    return header;
+}
+
+template <typename T>
+void Patch(vector<std::byte>& container, size_t offset, const T& value) noexcept
+{
+    std::memcpy(container.data() + offset, &value, sizeof value);
+}
+
+bool IsRejected(const vector<std::byte>& container, size_t size)
+{
+    try
+    {
+        const VVVContainerView view(container.data(), size);
+        return false;
+    }
+    catch (const std::invalid_argument&)
+    {
+        return true;
+    }
+}
+
+bool IsRejected(const vector<std::byte>& container)
+{
+    return IsRejected(container, container.size());
+}
+
+} // namespace
+
+
+TEST_CLASS(VVVContainerTest)
+{
+public:
+    TEST_METHOD(LoadFromIni)
+    {
+        const auto model = VVVContainerModel::LoadFromIni(IniText);
+
+        const auto* root = model.FindSection(u"");
+        Assert::IsNotNull(root);
+        Assert::IsTrue(root->label == u"Root");
+        Assert::AreEqual(3U, root->fileCount);
+        Assert::AreEqual(size_t{4}, root->items.size());
+        Assert::IsTrue(root->items[3].name == u"c d.txt");
+        Assert::IsFalse(root->items[2].active); // missing slot.
+        Assert::IsTrue(root->items[1].folder);
+        Assert::IsNotNull(model.FindSection(u"1"));
+    }
+
+    TEST_METHOD(IniToBinaryToViewRoundTrip)
+    {
+        const auto container = CreateContainer();
+        const VVVContainerView view(container.data(), container.size());
+
+        Assert::AreEqual(2U, view.GetSectionCount());
+        const auto* root = view.FindSection(u"");
+        Assert::IsNotNull(root);
+        Assert::IsTrue(view.GetString(root->label) == u"Root");
+        Assert::AreEqual(4U, root->itemCount);
+
+        const auto* items = view.GetItems(*root);
+        Assert::IsTrue(view.GetName(items[0]) == u"a.txt");
+        Assert::AreEqual(100U, items[0].size);
+        Assert::IsTrue(items[1].IsFolder());
+        Assert::IsFalse(items[2].IsActive());
+        Assert::IsTrue(view.GetName(items[3]) == u"c d.txt");
+
+        const auto* sub = view.FindSection(u"1");
+        Assert::IsNotNull(sub);
+        Assert::IsTrue(view.GetName(view.GetItems(*sub)[0]) == u"inner.txt");
+    }
+
+    TEST_METHOD(ModelRoundTrip)
+    {
+        const auto container = CreateContainer();
+        const VVVContainerView view(container.data(), container.size());
+
+        const auto serialized = VVVContainerModel::Load(view).Serialize();
+
+        Assert::IsTrue(container == serialized);
+    }
+
+    TEST_METHOD(FolderIndexAndSectionTree)
+    {
+        const auto container = CreateContainer();
+        const VVVContainerView view(container.data(), container.size());
+        const auto& root = *view.FindSection(u"");
+
+        Assert::IsTrue(view.HasFolderIndex());
+        uint32_t count;
+        const uint32_t* slots = view.GetFolderSlots(root, count);
+        Assert::AreEqual(1U, count);
+        Assert::AreEqual(1U, slots[0]);
+
+        Assert::IsTrue(view.HasSectionTree());
+        Assert::IsTrue(view.FindChildSection(root, 1) == view.FindSection(u"1"));
+        Assert::IsNull(view.FindChildSection(root, 3));
+    }
+
+    TEST_METHOD(TruncatedContainerIsRejected)
+    {
+        const auto container = CreateContainer();
+
+        for (size_t size = 0; size < container.size(); ++size)
+        {
+            Assert::IsTrue(IsRejected(container, size));
+        }
+    }
+
+    TEST_METHOD(SignatureAndVersionAreChecked)
+    {
+        auto container = CreateContainer();
+        Patch(container, offsetof(VVVContainerHeader, version), uint16_t{VVVContainerVersion + 1});
+        Assert::IsTrue(IsRejected(container));
+
+        container = CreateContainer();
+        Patch(container, offsetof(VVVContainerHeader, signature), uint32_t{0});
+        Assert::IsTrue(IsRejected(container));
+    }
+
+    TEST_METHOD(CorruptSectionTableIsRejected)
+    {
+        auto container = CreateContainer();
+        Patch(container, offsetof(VVVContainerHeader, sectionCount), uint32_t{1000});
+        Assert::IsTrue(IsRejected(container));
+
+        container = CreateContainer();
+        Patch(container, offsetof(VVVContainerHeader, sectionTableOffset), GetHeader(container).sectionTableOffset + 2); // misaligned.
+        Assert::IsTrue(IsRejected(container));
+
+        // The sections must be sorted on path: swap the 2 section records.
+        container = CreateContainer();
+        const size_t sectionTable = GetHeader(container).sectionTableOffset;
+        vector<std::byte> first(container.begin() + sectionTable, container.begin() + sectionTable + sizeof(VVVSectionRecord));
+        std::memcpy(container.data() + sectionTable, container.data() + sectionTable + sizeof(VVVSectionRecord), sizeof(VVVSectionRecord));
+        std::memcpy(container.data() + sectionTable + sizeof(VVVSectionRecord), first.data(), sizeof(VVVSectionRecord));
+        Assert::IsTrue(IsRejected(container));
+    }
+
+    TEST_METHOD(CorruptSectionItemRangeIsRejected)
+    {
+        auto container = CreateContainer();
+        const size_t rootSection = GetHeader(container).sectionTableOffset;
+        Patch(container, rootSection + offsetof(VVVSectionRecord, itemCount), uint32_t{100});
+        Assert::IsTrue(IsRejected(container));
+
+        container = CreateContainer();
+        Patch(container, rootSection + offsetof(VVVSectionRecord, firstFreeSlot), uint32_t{5});
+        Assert::IsTrue(IsRejected(container));
+    }
+
+    TEST_METHOD(CorruptItemTableIsRejected)
+    {
+        auto container = CreateContainer();
+        const auto header = GetHeader(container);
+        Patch(container, header.itemTableOffset + offsetof(VVVItemRecord, nameOffset), header.stringPoolSize);
+        Assert::IsTrue(IsRejected(container));
+
+        container = CreateContainer();
+        Patch(container, offsetof(VVVContainerHeader, itemCount), header.itemCount + 1000);
+        Assert::IsTrue(IsRejected(container));
+    }
+
+    TEST_METHOD(CorruptFolderIndexIsRejected)
+    {
+        auto container = CreateContainer();
+        VVVFolderIndexHeader folderIndex;
+        std::memcpy(&folderIndex, container.data() + sizeof(VVVContainerHeader), sizeof folderIndex);
+
+        // Point the folder slot of the root section beyond its items.
+        Patch(container, folderIndex.folderSlotTableOffset, uint32_t{4});
+        Assert::IsTrue(IsRejected(container));
+    }
+};
@@ -0,0 +1,142 @@
+﻿//
+// (C) Copyright by Victor Derks
+//
+// See README.TXT for the details of the software licence.
+//
+
+#include "pch.h"
+
+#include "../samples/vvvsample/columns.h"
+#include "../samples/vvvsample/vvv_item.h"
+
+#include <iterator>
+#include <string>
+#include <string_view>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using std::string_view;
+using std::wstring;
+using std::wstring_view;
+
+namespace {
+
+// Purpose: the layout of version 2 VVV PIDLs, the layout of new PIDLs.
+using ItemSchemaVersion2 = msf::PidlSchema<uint16_t, bool, uint32_t, uint32_t, wstring_view>;
+constexpr uint16_t TypeIDVersion2 = 0x5602;
+
+// Purpose: the layout of version 3 VVV PIDLs (with a stored sort key), as persisted by older versions of the sample.
+using ItemSchemaVersion3 = msf::PidlSchema<uint16_t, bool, uint32_t, uint32_t, wstring_view, string_view>;
+constexpr uint16_t TypeIDVersion3 = 0x5603;
+
+PUIDLIST_RELATIVE CreateVersion2ItemIdList(unsigned int id, unsigned int size, bool folder, wstring_view name)
+{
+    const PUIDLIST_RELATIVE pidl = msf::ItemIDList::CreateItemIdListWithTerminator(ItemSchemaVersion2::GetSize(TypeIDVersion2, folder, id, size, name));
+    ItemSchemaVersion2::Write(pidl->mkid.abID, TypeIDVersion2, folder, id, size, name);
+    return pidl;
+}
+
+PUIDLIST_RELATIVE CreateVersion3ItemIdList(unsigned int id, unsigned int size, bool folder, wstring_view name, string_view sortKey)
+{
+    const PUIDLIST_RELATIVE pidl = msf::ItemIDList::CreateItemIdListWithTerminator(ItemSchemaVersion3::GetSize(TypeIDVersion3, folder, id, size, name, sortKey));
+    ItemSchemaVersion3::Write(pidl->mkid.abID, TypeIDVersion3, folder, id, size, name, sortKey);
+    return pidl;
+}
+
+string_view GetNameSortKey(const VVVItem& item) noexcept
+{
+    return item.GetSortKey(static_cast<uint32_t>(ColumnName));
+}
+
+} // namespace
+
+
+TEST_CLASS(VVVItemTest)
+{
+public:
+    TEST_METHOD(PidlRoundTrip)
+    {
+        const msf::ItemIDList pidl(VVVItem::CreateItemIdList(7, 1234, false, L"file.txt"));
+
+        const VVVItem item(pidl.GetRelative());
+
+        Assert::AreEqual(7U, item.GetID());
+        Assert::AreEqual(1234U, item.GetSize());
+        Assert::IsFalse(item.IsFolder());
+        Assert::AreEqual(wstring(L"file.txt"), item.GetName());
+        Assert::AreEqual(size_t{8}, item.GetNameView().size());
+    }
+
+    TEST_METHOD(NewPidlsUseVersion2Layout)
+    {
+        const msf::ItemIDList pidl(VVVItem::CreateItemIdList(3, 0, true, L"sub"));
+        const msf::ItemIDList expected(CreateVersion2ItemIdList(3, 0, true, L"sub"));
+
+        Assert::AreEqual(ILGetSize(expected.GetRelative()), ILGetSize(pidl.GetRelative()));
+        Assert::IsTrue(memcmp(expected.GetRelative(), pidl.GetRelative(), ILGetSize(pidl.GetRelative())) == 0);
+    }
+
+    TEST_METHOD(Version3PidlRoundTrip)
+    {
+        const msf::ItemIDList pidl(CreateVersion3ItemIdList(7, 1234, false, L"file.txt", "stale key"));
+
+        const VVVItem item(pidl.GetRelative());
+
+        Assert::AreEqual(7U, item.GetID());
+        Assert::AreEqual(1234U, item.GetSize());
+        Assert::IsFalse(item.IsFolder());
+        Assert::AreEqual(wstring(L"file.txt"), item.GetName());
+    }
+
+    TEST_METHOD(Version3SortKeyIsNotUsed)
+    {
+        const msf::ItemIDList pidlVersion3(CreateVersion3ItemIdList(7, 1234, false, L"file.txt", "stale key"));
+        const msf::ItemIDList pidl(VVVItem::CreateItemIdList(7, 1234, false, L"file.txt"));
+        const VVVItem itemVersion3(pidlVersion3.GetRelative());
+        const VVVItem item(pidl.GetRelative());
+
+        Assert::IsTrue(GetNameSortKey(itemVersion3) != "stale key");
+        Assert::IsTrue(GetNameSortKey(itemVersion3) == GetNameSortKey(item));
+        Assert::AreEqual(0, itemVersion3.Compare(item, ColumnName, false));
+    }
+
+    TEST_METHOD(SortKeyOrdersLikeCompare)
+    {
+        const msf::ItemIDList folder(VVVItem::CreateItemIdList(9, 0, true, L"z"));
+        const msf::ItemIDList fileA(VVVItem::CreateItemIdList(5, 0, false, L"a"));
+        const msf::ItemIDList fileB1(VVVItem::CreateItemIdList(1, 0, false, L"b"));
+        const msf::ItemIDList fileB2(VVVItem::CreateItemIdList(2, 0, false, L"b"));
+        const VVVItem items[]{VVVItem(folder.GetRelative()), VVVItem(fileA.GetRelative()), VVVItem(fileB1.GetRelative()), VVVItem(fileB2.GetRelative())};
+
+        for (size_t i = 0; i + 1 < std::size(items); ++i)
+        {
+            Assert::IsTrue(msf::CompareSortKeys(GetNameSortKey(items[i]), GetNameSortKey(items[i + 1])) < 0);
+            Assert::IsTrue(items[i].Compare(items[i + 1], ColumnName, false) < 0);
+        }
+    }
+
+    TEST_METHOD(SizeColumnHasNoSortKey)
+    {
+        const msf::ItemIDList pidl(VVVItem::CreateItemIdList(1, 10, false, L"a"));
+
+        const VVVItem item(pidl.GetRelative());
+
+        Assert::IsTrue(item.GetSortKey(static_cast<uint32_t>(ColumnSize)).empty());
+        Assert::IsTrue(item.GetIntegerSortKey(static_cast<uint32_t>(ColumnSize)) == uint64_t{10});
+    }
+
+    TEST_METHOD(Version2PidlWithTooLongNameIsRejected)
+    {
+        const wstring name(MAX_PATH, L'a');
+        const msf::ItemIDList pidl(CreateVersion2ItemIdList(1, 0, false, name));
+
+        Assert::ExpectException<_com_error>([&pidl] { const VVVItem item(pidl.GetRelative()); });
+    }
+
+    TEST_METHOD(Version3PidlWithTooLongNameIsRejected)
+    {
+        const wstring name(MAX_PATH, L'a');
+        const msf::ItemIDList pidl(CreateVersion3ItemIdList(1, 0, false, name, "key"));
+
+        Assert::ExpectException<_com_error>([&pidl] { const VVVItem item(pidl.GetRelative()); });
+    }
+};